@@ -0,0 +1,256 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Runs every kernel from kernels.tvys and its C twin from kernels.c on the same
+// input and prints the best time per element of each and their ratio. Every run is
+// preceded by an untimed prepare step and followed by an untimed verify step,
+// warmup runs are discarded, and the two versions must produce the same checksum.
+// Usage: bench [name...]; BENCH_REPS sets the number of timed runs (default 20).
+
+void tv_fill(int32_t *a, int64_t n, int32_t value);
+int64_t tv_sum(const int32_t *a, int64_t n);
+double tv_dot(const double *a, const double *b, int64_t n);
+void tv_matmul(const double *a, const double *b, double *c, int64_t n);
+int64_t tv_hash(const int8_t *s, int64_t n, int64_t seed);
+void tv_sort(int32_t *a, int64_t lo, int64_t hi);
+int64_t tv_count(const int8_t *s, int64_t n, int8_t c);
+int64_t tv_length(const int8_t *s);
+
+void c_fill(int32_t *a, int64_t n, int32_t value);
+int64_t c_sum(const int32_t *a, int64_t n);
+double c_dot(const double *a, const double *b, int64_t n);
+void c_matmul(const double *restrict a, const double *restrict b, double *restrict c, int64_t n);
+int64_t c_hash(const int8_t *s, int64_t n, int64_t seed);
+void c_sort(int32_t *a, int64_t lo, int64_t hi);
+int64_t c_count(const int8_t *s, int64_t n, int8_t c);
+int64_t c_length(const int8_t *s);
+
+#define ARRAY_N (1 << 20)
+#define TEXT_N (1 << 22)
+#define SORT_N (1 << 18)
+#define MATRIX_N 256
+#define WARMUP 3
+#define FNV_OFFSET ((int64_t)0xcbf29ce484222325u)
+
+static int32_t *ints;
+static int32_t *filled;
+static int32_t *sortInput;
+static int32_t *sortWork;
+static double *xs;
+static double *ys;
+static double *matrixA;
+static double *matrixB;
+static double *matrixC;
+static int8_t *text;
+
+static void *allocate(size_t bytes)
+{
+    void *p = aligned_alloc(64, bytes);
+    if (!p)
+    {
+        perror("bench");
+        exit(1);
+    }
+    return p;
+}
+
+static void setup(void)
+{
+    ints = allocate(ARRAY_N * sizeof(int32_t));
+    filled = allocate(ARRAY_N * sizeof(int32_t));
+    sortInput = allocate(SORT_N * sizeof(int32_t));
+    sortWork = allocate(SORT_N * sizeof(int32_t));
+    xs = allocate(ARRAY_N * sizeof(double));
+    ys = allocate(ARRAY_N * sizeof(double));
+    matrixA = allocate(MATRIX_N * MATRIX_N * sizeof(double));
+    matrixB = allocate(MATRIX_N * MATRIX_N * sizeof(double));
+    matrixC = allocate(MATRIX_N * MATRIX_N * sizeof(double));
+    text = allocate(TEXT_N + 1);
+
+    uint64_t state = 0x9e3779b97f4a7c15u;
+    for (int64_t i = 0; i < ARRAY_N; i++)
+    {
+        state = state * 6364136223846793005u + 1442695040888963407u;
+        ints[i] = (int32_t)(state >> 33) - (1 << 30);
+        xs[i] = (double)(state >> 40) / (double)(1 << 24);
+        ys[i] = 1.0 - xs[i];
+    }
+    for (int64_t i = 0; i < SORT_N; i++)
+        sortInput[i] = ints[i];
+    for (int64_t i = 0; i < MATRIX_N * MATRIX_N; i++)
+    {
+        matrixA[i] = xs[i];
+        matrixB[i] = ys[i];
+    }
+    // Words of lowercase letters separated by spaces and the odd newline.
+    for (int64_t i = 0; i < TEXT_N; i++)
+    {
+        state = state * 6364136223846793005u + 1442695040888963407u;
+        const unsigned pick = (unsigned)(state >> 58);
+        text[i] = (int8_t)(pick < 8 ? ' ' : pick == 8 ? '\n' : 'a' + pick % 26);
+    }
+    text[TEXT_N] = 0;
+}
+
+static int64_t runFill(int version)
+{
+    // fill writes its own buffer so that sum still sees the random ints.
+    (version ? c_fill : tv_fill)(filled, ARRAY_N, 42);
+    return filled[ARRAY_N / 2];
+}
+
+static int64_t runSum(int version)
+{
+    return (version ? c_sum : tv_sum)(ints, ARRAY_N);
+}
+
+static int64_t runDot(int version)
+{
+    const double result = (version ? c_dot : tv_dot)(xs, ys, ARRAY_N);
+    int64_t bits;
+    memcpy(&bits, &result, sizeof(bits));
+    return bits;
+}
+
+static int64_t runMatmul(int version)
+{
+    (version ? c_matmul : tv_matmul)(matrixA, matrixB, matrixC, MATRIX_N);
+    return 0;
+}
+
+static int64_t verifyMatmul(int64_t result)
+{
+    (void)result;
+    double trace = 0.0;
+    for (int64_t i = 0; i < MATRIX_N; i++)
+        trace += matrixC[i * MATRIX_N + i];
+    int64_t bits;
+    memcpy(&bits, &trace, sizeof(bits));
+    return bits;
+}
+
+static int64_t runHash(int version)
+{
+    return (version ? c_hash : tv_hash)(text, TEXT_N, FNV_OFFSET);
+}
+
+static void prepareSort(void)
+{
+    memcpy(sortWork, sortInput, SORT_N * sizeof(int32_t));
+}
+
+static int64_t runSort(int version)
+{
+    (version ? c_sort : tv_sort)(sortWork, 0, SORT_N);
+    return 0;
+}
+
+static int64_t verifySort(int64_t result)
+{
+    (void)result;
+    for (int64_t i = 1; i < SORT_N; i++)
+        if (sortWork[i - 1] > sortWork[i])
+            return -1;
+    return sortWork[SORT_N / 2];
+}
+
+static int64_t runCount(int version)
+{
+    return (version ? c_count : tv_count)(text, TEXT_N, ' ');
+}
+
+static int64_t runLength(int version)
+{
+    return (version ? c_length : tv_length)(text);
+}
+
+typedef struct
+{
+    const char *name;
+    int64_t elements;
+    void (*prepare)(void);
+    // version 0 runs the Toornvys kernel, 1 the C one; returns a checksum.
+    int64_t (*run)(int version);
+    // Turns run's result into the checksum outside the timed region, for kernels
+    // whose output has to be inspected.
+    int64_t (*verify)(int64_t result);
+} benchmark;
+
+static const benchmark benchmarks[] = {
+    {"fill", ARRAY_N, NULL, runFill, NULL},
+    {"sum", ARRAY_N, NULL, runSum, NULL},
+    {"dot", ARRAY_N, NULL, runDot, NULL},
+    {"matmul", (int64_t)MATRIX_N * MATRIX_N * MATRIX_N, NULL, runMatmul, verifyMatmul},
+    {"hash", TEXT_N, NULL, runHash, NULL},
+    {"sort", SORT_N, prepareSort, runSort, verifySort},
+    {"count", TEXT_N, NULL, runCount, NULL},
+    {"length", TEXT_N, NULL, runLength, NULL},
+};
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// Best time of reps runs, in nanoseconds; *checksum is that of the last run.
+static double measure(const benchmark *b, int version, int reps, int64_t *checksum)
+{
+    double best = 0.0;
+    for (int i = -WARMUP; i < reps; i++)
+    {
+        if (b->prepare)
+            b->prepare();
+        const double start = now();
+        const int64_t result = b->run(version);
+        const double elapsed = now() - start;
+        *checksum = b->verify ? b->verify(result) : result;
+        if (i >= 0 && (i == 0 || elapsed < best))
+            best = elapsed;
+    }
+    return best;
+}
+
+static int selected(const char *name, int argc, char **argv)
+{
+    if (argc < 2)
+        return 1;
+    for (int i = 1; i < argc; i++)
+        if (strcmp(argv[i], name) == 0)
+            return 1;
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *repsEnv = getenv("BENCH_REPS");
+    const int reps = repsEnv && atoi(repsEnv) > 0 ? atoi(repsEnv) : 20;
+    setup();
+
+    int failed = 0;
+    printf("%-8s %12s %14s %14s %8s\n", "kernel", "elements", "tvys ns/elem", "C ns/elem", "tvys/C");
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++)
+    {
+        const benchmark *b = &benchmarks[i];
+        if (!selected(b->name, argc, argv))
+            continue;
+
+        int64_t tvysChecksum;
+        int64_t cChecksum;
+        const double tvys = measure(b, 0, reps, &tvysChecksum) / (double)b->elements;
+        const double c = measure(b, 1, reps, &cChecksum) / (double)b->elements;
+        printf("%-8s %12lld %14.4f %14.4f %8.2f", b->name, (long long)b->elements, tvys, c, tvys / c);
+        if (tvysChecksum != cChecksum)
+        {
+            printf("  MISMATCH (%lld vs %lld)", (long long)tvysChecksum, (long long)cChecksum);
+            failed = 1;
+        }
+        printf("\n");
+    }
+    return failed;
+}
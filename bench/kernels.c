@@ -0,0 +1,114 @@
+#include <stdint.h>
+
+// C twins of the kernels in kernels.tvys. Toornvys integers wrap, so the hash is
+// computed in unsigned arithmetic.
+
+void c_fill(int32_t *a, int64_t n, int32_t value)
+{
+    for (int64_t i = 0; i < n; i++)
+        a[i] = value;
+}
+
+int64_t c_sum(const int32_t *a, int64_t n)
+{
+    int64_t total = 0;
+    for (int64_t i = 0; i < n; i++)
+        total += a[i];
+    return total;
+}
+
+double c_dot(const double *a, const double *b, int64_t n)
+{
+    double total = 0.0;
+    for (int64_t i = 0; i < n; i++)
+        total += a[i] * b[i];
+    return total;
+}
+
+void c_matmul(const double *restrict a, const double *restrict b, double *restrict c, int64_t n)
+{
+    for (int64_t i = 0; i < n; i++)
+    {
+        for (int64_t j = 0; j < n; j++)
+            c[i * n + j] = 0.0;
+        for (int64_t k = 0; k < n; k++)
+        {
+            const double aik = a[i * n + k];
+            for (int64_t j = 0; j < n; j++)
+                c[i * n + j] += aik * b[k * n + j];
+        }
+    }
+}
+
+int64_t c_hash(const int8_t *s, int64_t n, int64_t seed)
+{
+    uint64_t h = (uint64_t)seed;
+    for (int64_t i = 0; i < n; i++)
+        h = (h ^ (uint64_t)(int64_t)s[i]) * 1099511628211u;
+    return (int64_t)h;
+}
+
+void c_sort(int32_t *a, int64_t lo, int64_t hi)
+{
+    int64_t left = lo;
+    int64_t right = hi;
+    while (right - left > 16)
+    {
+        const int32_t pivot = a[left + (right - left) / 2];
+        int64_t i = left;
+        int64_t j = right - 1;
+        while (i <= j)
+        {
+            while (a[i] < pivot)
+                i++;
+            while (a[j] > pivot)
+                j--;
+            if (i <= j)
+            {
+                const int32_t t = a[i];
+                a[i] = a[j];
+                a[j] = t;
+                i++;
+                j--;
+            }
+        }
+        if (j + 1 - left < right - i)
+        {
+            c_sort(a, left, j + 1);
+            left = i;
+        }
+        else
+        {
+            c_sort(a, i, right);
+            right = j + 1;
+        }
+    }
+    for (int64_t k = left + 1; k < right; k++)
+    {
+        const int32_t v = a[k];
+        int64_t m = k;
+        while (m > left && a[m - 1] > v)
+        {
+            a[m] = a[m - 1];
+            m--;
+        }
+        a[m] = v;
+    }
+}
+
+int64_t c_count(const int8_t *s, int64_t n, int8_t c)
+{
+    int64_t count = 0;
+    for (int64_t i = 0; i < n; i++)
+        if (s[i] == c)
+            count++;
+    return count;
+}
+
+int64_t c_length(const int8_t *s)
+{
+    int64_t i = 0;
+    while (s[i] != 0)
+        i++;
+    return i;
+}
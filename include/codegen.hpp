@@ -3,9 +3,12 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/ValueHandle.h"
+#include "llvm/IR/DIBuilder.h"
 #include <llvm/Support/raw_ostream.h>
 #include "../include/parser.hpp"
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <string>
 #include <memory>
@@ -20,9 +23,14 @@ public:
         llvm::Value *value;
         llvm::Type *type;
         std::string baseType;
+        bool isValue = false;
+        int aliasScope = -1;
+        bool isConst = false;
+        int ssaSlot = -1;
     };
 
-    void addVariable(const std::string &name, llvm::Value *value, llvm::Type *type, const std::string &baseType);
+    Symbol &addVariable(const std::string &name, llvm::Value *value, llvm::Type *type, const std::string &baseType);
+    void addValue(const std::string &name, llvm::Value *value, llvm::Type *type, const std::string &baseType);
     const Symbol *lookupVariable(const std::string &name) const;
     void enterScope();
     void exitScope();
@@ -35,10 +43,25 @@ class CodeGenerator
 {
 public:
     CodeGenerator(const std::string &moduleName)
-        : context(), module(std::make_unique<llvm::Module>(moduleName, context)), builder(context), currentFunction(nullptr), hasReturn(false) {}
+        : context(), module(std::make_unique<llvm::Module>(moduleName, context)), builder(context), currentFunction(nullptr), hasReturn(false), flattenCalls(false) {}
+
+    enum class DebugLevel
+    {
+        None,
+        // Source locations for optimization remarks; no DWARF is emitted.
+        LocationsOnly,
+        LineTables,
+        Full
+    };
 
     void generate(const Node *root);
-    void generateRuntime();
+    void enableDebugInfo(DebugLevel level, const std::string &sourcePath, bool optimized);
+    void finalizeDebugInfo();
+    void setBoundsChecks(bool enabled) { boundsChecks = enabled; }
+    void setFreestanding(bool enabled) { freestanding = enabled; }
+    void generateFreestandingRuntime();
+    void instrumentFunctions();
+    void emitProfileMap();
     llvm::Module *getModule() const { return module.get(); }
 
 private:
@@ -51,23 +74,146 @@ private:
     llvm::Value *handleUnaryOp(const class NodeUnaryOp *node, llvm::Type *expectedType);
     llvm::Value *handleCast(const class NodeCast *node);
     llvm::Value *handleString(const class NodeString *node);
+    llvm::Constant *getStringConstant(const std::string &value);
     llvm::Value *handleAssignment(const class NodeAssignment *node, llvm::Type *expectedType);
     llvm::Value *handlePointerAssignment(const class NodePointerAssignment *node);
     llvm::Value *handleArrayAccess(const class NodeArrayAccess *node);
     llvm::Value *handleArrayAssignment(const class NodeArrayAssignment *node);
-    llvm::Value *handleIdentifier(const class NodeIdentifier *node);
+    llvm::Value *handleIdentifier(const class NodeIdentifier *node, llvm::Type *expectedType);
+    llvm::Value *loadVariable(const SymbolTable::Symbol *sym, const std::string &name);
+    int createRestrictScope(const std::string &name);
+    void tagRestrictAccess(llvm::Value *access, const SymbolTable::Symbol *sym);
+    void tagRestrictAccess(llvm::Value *access, const Node *pointer);
+    void applyRestrictScopes(llvm::Function *function);
     llvm::Value *handleNumber(const class NodeNumber *node, llvm::Type *expectedType);
+    llvm::Value *handleFloat(const class NodeFloat *node, llvm::Type *expectedType);
     llvm::Value *handleBinaryOp(const class NodeBinaryOp *node, llvm::Type *expectedType);
+    llvm::Value *handleFloatBinaryOp(const class NodeBinaryOp *node, llvm::Value *left, llvm::Value *right, llvm::Type *expectedType);
+    llvm::Value *handleLogicalOp(const class NodeBinaryOp *node);
+    llvm::Value *widenComparison(llvm::Value *cmp, llvm::Type *expectedType);
+    llvm::Value *generateCondition(const Node *node);
+    void emitConditionalBranch(const Node *condition, llvm::BasicBlock *trueBlock, llvm::BasicBlock *falseBlock, BranchHint hint = BranchHint::None);
+    llvm::Type *inferOperandType(const Node *left, const Node *right);
+    llvm::Type *inferExpressionType(const Node *node);
     llvm::Value *handleFunctionCall(const class NodeFunctionCall *node, llvm::Type *expectedType);
+    llvm::Value *handleBuiltinCall(const class NodeBuiltinCall *node, llvm::Type *expectedType);
+    llvm::Value *handleVectorBuiltin(const class NodeBuiltinCall *node, llvm::Type *expectedType);
+    llvm::Value *getElementPointer(const SymbolTable::Symbol *sym, const Node *indexNode, llvm::Type *&elementType, int line);
+    llvm::Type *getBuiltinType(const class NodeBuiltinCall *node, llvm::Type *expectedType);
+    llvm::Value *handleSliceBuiltin(const class NodeBuiltinCall *node, llvm::Type *expectedType);
+    llvm::Value *handleBitBuiltin(const class NodeBuiltinCall *node, llvm::Type *expectedType);
+    static bool isBitBuiltin(const std::string &name);
+    llvm::Value *handleAtomicBuiltin(const class NodeBuiltinCall *node, llvm::Type *expectedType);
+    llvm::Type *inferAtomicType(const class NodeBuiltinCall *node);
+    static bool isAtomicBuiltin(const std::string &name);
+    llvm::Value *handleAsyncBuiltin(const class NodeBuiltinCall *node);
+    llvm::Value *handleMemoryBuiltin(const class NodeBuiltinCall *node);
+    llvm::Type *inferMemoryType(const class NodeBuiltinCall *node);
+    static bool isMemoryBuiltin(const std::string &name);
+    llvm::Value *handleArrayLiteral(const class NodeArrayLiteral *node, llvm::Type *expectedType);
+    llvm::Constant *getConstantInitializer(const Node *node, llvm::Type *type);
+    llvm::Value *toVectorMask(llvm::Value *mask, llvm::FixedVectorType *vectorType, int line);
 
     void generateFuncDeclaration(const class NodeFunctionDeclaration *node);
+    void requireHostedRuntime(int line, const char *feature);
+    llvm::Function *getRuntimeFunction(const std::string &name);
+    llvm::Function *findExistingFunction(const std::string &name, llvm::FunctionType *type, int line);
     void generateExternDeclaration(const class NodeExternDeclaration *node);
+    void applyFunctionAttributes(llvm::Function *function, const std::vector<Attribute> &attributes, bool isDefinition);
     void generateStatement(const Node *stmt);
     llvm::Value *generateVarDeclaration(const class NodeVariableDeclaration *node);
+    llvm::Value *generateGlobalDeclaration(const class NodeVariableDeclaration *node);
+    void initializeAggregate(llvm::AllocaInst *alloca, llvm::Type *type, const Node *initializer, const std::string &name, int line);
+    bool literalFillsType(const class NodeArrayLiteral *literal, llvm::Type *type);
+    void storeArrayLiteral(llvm::Value *ptr, llvm::Type *type, const class NodeArrayLiteral *literal, bool zeroed);
     void generateWhileStatement(const NodeWhile* node);
+    void generateForStatement(const NodeFor *node);
+    void emitForRange(const NodeFor *node, llvm::Value *start, llvm::Value *end, llvm::Value *step, bool descending);
+    void emitCountedLoop(const NodeFor *node, llvm::Value *start, llvm::Value *end, llvm::Value *step, bool descending);
+    llvm::MDNode *buildLoopMetadata(const std::vector<Attribute> &attributes);
+
+    struct ParallelCapture
+    {
+        std::string name;
+        SymbolTable::Symbol symbol;
+        bool byReference;
+        const NodeFor::Reduction *reduction;
+    };
+    void generateParallelFor(const NodeFor *node);
+    llvm::Function *outlineParallelBody(const NodeFor *node, const std::vector<ParallelCapture> &captures, llvm::StructType *contextType);
+    void emitReductionCombine(const NodeFor::Reduction &reduction, llvm::Value *shared, llvm::Value *partial);
+    static std::unordered_set<std::string> collectParallelWrites(const NodeFor *node);
+
     void generateIfStatement(const NodeIf *node);
+    void generateMatchStatement(const NodeMatch *node);
     void generateReturn(const class NodeReturn *node);
+    void generateTailCall(const class NodeReturn *node);
+
+    // Blocks and values shared by every suspend point of the async fn being generated.
+    struct CoroutineState
+    {
+        llvm::Value *id = nullptr;
+        llvm::Value *handle = nullptr;
+        llvm::AllocaInst *promise = nullptr;
+        llvm::StructType *promiseType = nullptr;
+        llvm::Type *resultType = nullptr;
+        llvm::BasicBlock *finalBlock = nullptr;
+        llvm::BasicBlock *cleanupBlock = nullptr;
+        llvm::BasicBlock *suspendBlock = nullptr;
+    };
+    llvm::StructType *getPromiseType(llvm::Type *resultType);
+    llvm::Type *getTaskResultType(const std::string &typeName);
+    llvm::Type *getAwaitResultType(const Node *operand);
+    void checkTaskValue(const std::string &typeName, const Node *value, int line);
+    void beginCoroutine(llvm::Function *function, llvm::Type *resultType, int line);
+    void finishCoroutine();
+    void emitSuspend(const std::string &resumeName);
+    void generateAsyncReturn(const class NodeReturn *node);
+    llvm::Value *handleAwait(const class NodeAwait *node, llvm::Type *expectedType);
+    bool isSliceType(llvm::Type *type) const;
+    llvm::Value *makeSlice(llvm::Type *sliceType, llvm::Value *data, llvm::Value *length);
+    llvm::Value *getArrayLength(const SymbolTable::Symbol *sym);
+    void emitBoundsCheck(llvm::Value *index, llvm::Value *length, llvm::Value *guard = nullptr);
+
+    struct BoundsCheckCandidate
+    {
+        const Node *index;
+        std::string arrayName;
+        int64_t offset;
+    };
+    std::vector<BoundsCheckCandidate> elideBoundsChecks(const NodeFor *node, llvm::Value *start, llvm::Value *end);
+    llvm::Value *emitBoundsGuard(const std::vector<BoundsCheckCandidate> &candidates, llvm::Value *start, llvm::Value *end);
+
+    struct SSAVariable
+    {
+        std::string name;
+        llvm::Type *type;
+        std::unordered_map<llvm::BasicBlock *, llvm::WeakTrackingVH> defs;
+        llvm::DILocalVariable *debugVariable = nullptr;
+    };
+    void collectAddressTaken(const Node *body);
+    bool canPromote(const std::string &name, llvm::Type *type) const;
+    int declareSSAVariable(const std::string &name, llvm::Type *type);
+    void writeVariable(int slot, llvm::BasicBlock *block, llvm::Value *value);
+    llvm::Value *readVariable(int slot, llvm::BasicBlock *block);
+    llvm::Value *readVariableRecursive(int slot, llvm::BasicBlock *block);
+    llvm::PHINode *createPhi(const SSAVariable &var, llvm::BasicBlock *block);
+    llvm::Value *addPhiOperands(int slot, llvm::PHINode *phi);
+    llvm::Value *tryRemoveTrivialPhi(llvm::PHINode *phi);
+    void sealBlock(llvm::BasicBlock *block);
+    void resetSSAState();
+
+    llvm::DIType *getDebugType(const std::string &typeName);
+    void beginDebugFunction(llvm::Function *function, const class NodeFunctionDeclaration *node, int line);
+    void finishDebugFunction();
+    void setDebugLocation(int line);
+    llvm::DILocalVariable *createDebugVariable(const std::string &name, const std::string &type, int line, unsigned argNo = 0);
+    void emitDebugDeclare(llvm::DILocalVariable *variable, llvm::Value *storage);
+    void emitDebugValue(llvm::DILocalVariable *variable, llvm::Value *value);
+    void emitDebugGlobal(llvm::GlobalVariable *global, const std::string &name, const std::string &type, int line);
+
     llvm::Value *castValue(llvm::Value *value, llvm::Type *expectedType);
+    llvm::Value *generateCastExpression(const Node *node, llvm::Type *type);
     llvm::AllocaInst *createEntryBlockAlloca(llvm::Function *function, const std::string &varName, llvm::Type *varType);
 
     llvm::LLVMContext context;
@@ -75,9 +221,36 @@ private:
     llvm::IRBuilder<> builder;
     llvm::Function *currentFunction;
     bool hasReturn;
+    bool flattenCalls;
 
     std::unordered_map<std::string, llvm::StructType *> structTypes;
     std::unordered_map<std::string, std::vector<std::string>> structFieldNames;
+    std::unordered_map<std::string, llvm::Constant *> stringPool;
+    std::unordered_map<std::string, llvm::Type *> asyncResultTypes;
+    CoroutineState coroutine;
+
+    bool boundsChecks = false;
+    bool freestanding = false;
+    std::unordered_set<const Node *> uncheckedIndices;
+    std::unordered_map<const Node *, llvm::Value *> guardedIndices;
+    llvm::BasicBlock *boundsFailBlock = nullptr;
+
+    std::unordered_set<std::string> addressTaken;
+    std::vector<SSAVariable> ssaVariables;
+    std::unordered_set<llvm::BasicBlock *> unsealedBlocks;
+    std::unordered_map<llvm::BasicBlock *, std::vector<std::pair<int, llvm::PHINode *>>> incompletePhis;
+    std::unordered_set<llvm::PHINode *> pendingPhis;
+
+    std::unique_ptr<llvm::DIBuilder> debugBuilder;
+    llvm::DICompileUnit *debugUnit = nullptr;
+    llvm::DIFile *debugFile = nullptr;
+    llvm::DISubprogram *debugScope = nullptr;
+    bool debugVariables = false;
+    std::unordered_map<std::string, llvm::DIType *> debugTypes;
+    std::vector<std::pair<llvm::WeakVH, llvm::DILocalVariable *>> debugPhis;
+
+    std::vector<std::string> restrictScopes;
+    std::vector<std::pair<llvm::Instruction *, int>> restrictAccesses;
 
     SymbolTable symbolTable;
 };
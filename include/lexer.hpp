@@ -25,30 +25,54 @@ public:
 		TOKEN_RBRACE,
 		TOKEN_LBRACKET,
 		TOKEN_RBRACKET,
+		TOKEN_HASH,
+		TOKEN_CARET,
+		TOKEN_PERCENT,
 
 		// Multi-character tokens
 		TOKEN_ARROW,
 		TOKEN_FAT_ARROW,
+		TOKEN_DOT_DOT,
+		TOKEN_DOT_DOT_EQUAL,
 		TOKEN_EQUAL_EQUAL,
 		TOKEN_BANG_EQUAL,
 		TOKEN_LESS_EQUAL,
 		TOKEN_GREATER_EQUAL,
 		TOKEN_LESS,
 		TOKEN_GREATER,
+		TOKEN_SHL,
+		TOKEN_SHR,
+		TOKEN_AND_AND,
+		TOKEN_PIPE_PIPE,
+		TOKEN_BANG,
+		TOKEN_PIPE,
 
 		// Literals
 		TOKEN_NUMBER,
 		TOKEN_STRING,
 		TOKEN_IDENTIFIER,
+		TOKEN_BUILTIN,
 
 		// Keywords
 		TOKEN_LET,
 		TOKEN_FN,
 		TOKEN_WHILE,
+		TOKEN_FOR,
+		TOKEN_PARALLEL,
 		TOKEN_IF,
+		TOKEN_MATCH,
 		TOKEN_ELSE,
 		TOKEN_RETURN,
+		TOKEN_BECOME,
+		TOKEN_ASYNC,
+		TOKEN_AWAIT,
 		TOKEN_REF,
+		TOKEN_RESTRICT,
+		TOKEN_STATIC,
+		TOKEN_CONST,
+		TOKEN_THREAD_LOCAL,
+		TOKEN_TRUE,
+		TOKEN_FALSE,
 		TOKEN_EXTERN,
 		TOKEN_INT_TYPE,
 
@@ -81,6 +105,7 @@ public:
 private:
 	Token nextToken();
 	Token identifierOrKeyword();
+	Token builtinName();
 	Token numberLiteral();
 	Token stringLiteral();
 
@@ -89,6 +114,7 @@ private:
 	char peek() const;
 	bool match(char expected);
 	bool isIdentifierChar(char c) const;
+	static bool isVectorTypeName(const std::string &name);
 
 	static const std::unordered_map<std::string, Token::Kind> keywords;
 	static const std::unordered_map<char, Token::Kind> singleCharTokens;
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+class Attribute
+{
+public:
+    Attribute(const std::string &name, std::vector<std::string> args, int line)
+        : name(name), args(std::move(args)), line(line) {}
+
+    const std::string &getName() const { return name; }
+    const std::vector<std::string> &getArgs() const { return args; }
+    int getLine() const { return line; }
+
+private:
+    std::string name;
+    std::vector<std::string> args;
+    int line;
+};
\ No newline at end of file
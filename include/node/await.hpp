@@ -0,0 +1,19 @@
+#pragma once
+
+#include "node.hpp"
+
+// `await operand` inside an async fn: suspends until operand (a task, or
+// @readable / @writable / @yield) is ready.
+class NodeAwait : public Node
+{
+public:
+	NodeAwait(std::unique_ptr<Node> operand, int line)
+		: operand(std::move(operand)), line(line) {}
+
+	const Node *getOperand() const { return operand.get(); }
+	int getLine() const override { return line; }
+
+private:
+	std::unique_ptr<Node> operand;
+	int line;
+};
\ No newline at end of file
@@ -15,8 +15,12 @@ public:
 
 	const std::vector<std::unique_ptr<Node>> &getStatements() const { return statements; }
 	int getLine() const override { return line; }
+	// Line of the closing brace, where control leaves the block.
+	int getEndLine() const { return endLine; }
+	void setEndLine(int value) { endLine = value; }
 
 private:
 	std::vector<std::unique_ptr<Node>> statements;
 	int line;
+	int endLine = 0;
 };
\ No newline at end of file
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "node.hpp"
+
+class NodeBuiltinCall : public Node
+{
+public:
+	NodeBuiltinCall(const std::string &name, std::vector<std::string> typeArgs, std::vector<std::unique_ptr<Node>> args, int line)
+		: name(name), typeArgs(std::move(typeArgs)), args(std::move(args)), line(line) {}
+
+	const std::string &getName() const { return name; }
+	const std::vector<std::string> &getTypeArgs() const { return typeArgs; }
+	const std::vector<std::unique_ptr<Node>> &getArgs() const { return args; }
+	int getLine() const override { return line; }
+
+private:
+	std::string name;
+	std::vector<std::string> typeArgs;
+	std::vector<std::unique_ptr<Node>> args;
+	int line;
+};
\ No newline at end of file
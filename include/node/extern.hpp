@@ -1,6 +1,7 @@
 #pragma once
 
 #include "node.hpp"
+#include "attribute.hpp"
 
 class NodeExternDeclaration : public Node
 {
@@ -11,11 +12,14 @@ public:
     const std::string &getName() const { return name; }
     const std::vector<std::pair<std::string, std::string>> &getArgs() const { return args; }
     const std::string &getReturnType() const { return returnType; }
+    const std::vector<Attribute> &getAttributes() const { return attributes; }
+    void setAttributes(std::vector<Attribute> attrs) { attributes = std::move(attrs); }
     int getLine() const override { return line; }
 
 private:
     std::string name;
     std::vector<std::pair<std::string, std::string>> args;
     std::string returnType;
+    std::vector<Attribute> attributes;
     int line;
 };
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "node.hpp"
+#include "attribute.hpp"
+
+class NodeFor : public Node
+{
+public:
+    // reduce(op: var) on a parallel for: each worker accumulates privately and the
+    // partial results are combined into var when its chunk finishes.
+    struct Reduction
+    {
+        std::string op;
+        std::string varName;
+        int line;
+    };
+
+    NodeFor(const std::string &varName, std::unique_ptr<Node> start, std::unique_ptr<Node> end, std::unique_ptr<Node> step, std::unique_ptr<Node> body, int line)
+        : varName(varName), start(std::move(start)), end(std::move(end)), step(std::move(step)), body(std::move(body)), line(line) {}
+
+    const std::string &getVarName() const { return varName; }
+    const Node *getStart() const { return start.get(); }
+    const Node *getEnd() const { return end.get(); }
+    const Node *getStep() const { return step.get(); }
+    const Node *getBody() const { return body.get(); }
+    const std::vector<Attribute> &getAttributes() const { return attributes; }
+    void setAttributes(std::vector<Attribute> attrs) { attributes = std::move(attrs); }
+    bool isParallel() const { return parallel; }
+    const std::vector<Reduction> &getReductions() const { return reductions; }
+    void setParallel(std::vector<Reduction> reds)
+    {
+        parallel = true;
+        reductions = std::move(reds);
+    }
+    int getLine() const override { return line; }
+
+private:
+    std::string varName;
+    std::unique_ptr<Node> start;
+    std::unique_ptr<Node> end;
+    std::unique_ptr<Node> step;
+    std::unique_ptr<Node> body;
+    std::vector<Attribute> attributes;
+    bool parallel = false;
+    std::vector<Reduction> reductions;
+    int line;
+};
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "node.hpp"
+#include "attribute.hpp"
 
 class NodeFunctionDeclaration : public Node
 {
@@ -12,6 +13,10 @@ public:
 	const std::vector<std::pair<std::string, std::string>> &getArgs() const { return args; }
 	const std::unique_ptr<Node> &getBody() const { return body; }
 	const std::string &getReturnType() const { return returnType; }
+	const std::vector<Attribute> &getAttributes() const { return attributes; }
+	void setAttributes(std::vector<Attribute> attrs) { attributes = std::move(attrs); }
+	bool isAsync() const { return async; }
+	void setAsync(bool isAsync) { async = isAsync; }
 	int getLine() const override { return line; }
 
 private:
@@ -19,5 +24,7 @@ private:
 	std::vector<std::pair<std::string, std::string>> args;
 	std::unique_ptr<Node> body;
 	std::string returnType;
+	std::vector<Attribute> attributes;
+	bool async = false;
 	int line;
 };
\ No newline at end of file
@@ -11,11 +11,14 @@ public:
     const Node *getCondition() const { return condition.get(); }
     const Node *getThenBranch() const { return thenBranch.get(); }
     const Node *getElseBranch() const { return elseBranch.get(); }
+    BranchHint getHint() const { return hint; }
+    void setHint(BranchHint branchHint) { hint = branchHint; }
     int getLine() const override { return line; }
 
 private:
     std::unique_ptr<Node> condition;
     std::unique_ptr<Node> thenBranch;
     std::unique_ptr<Node> elseBranch;
+    BranchHint hint = BranchHint::None;
     int line;
 };
\ No newline at end of file
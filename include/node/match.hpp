@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "node.hpp"
+
+// Inclusive range of values matched by a pattern; a single literal has low == high.
+struct MatchPattern
+{
+    int64_t low;
+    int64_t high;
+};
+
+struct MatchArm
+{
+    std::vector<MatchPattern> patterns;
+    bool isDefault;
+    std::unique_ptr<Node> body;
+    int line;
+};
+
+class NodeMatch : public Node
+{
+public:
+    NodeMatch(std::unique_ptr<Node> subject, std::vector<MatchArm> arms, int line)
+        : subject(std::move(subject)), arms(std::move(arms)), line(line) {}
+
+    const Node *getSubject() const { return subject.get(); }
+    const std::vector<MatchArm> &getArms() const { return arms; }
+    int getLine() const override { return line; }
+
+private:
+    std::unique_ptr<Node> subject;
+    std::vector<MatchArm> arms;
+    int line;
+};
\ No newline at end of file
@@ -3,6 +3,14 @@
 #include <memory>
 #include "lexer.hpp"
 
+// Expected outcome of a branch condition, from likely(...) / unlikely(...) or #[cold] blocks.
+enum class BranchHint
+{
+	None,
+	Likely,
+	Unlikely
+};
+
 class Node
 {
 public:
@@ -5,13 +5,41 @@
 class NodeNumber : public Node
 {
 public:
-	explicit NodeNumber(int value, int line)
+	explicit NodeNumber(int64_t value, int line)
 		: value(value), line(line) {}
 
-	int getValue() const { return value; }
+	int64_t getValue() const { return value; }
 	int getLine() const override { return line; }
 
 private:
-	int value;
+	int64_t value;
+	int line;
+};
+
+class NodeFloat : public Node
+{
+public:
+	explicit NodeFloat(double value, int line)
+		: value(value), line(line) {}
+
+	double getValue() const { return value; }
+	int getLine() const override { return line; }
+
+private:
+	double value;
+	int line;
+};
+
+class NodeBool : public Node
+{
+public:
+	explicit NodeBool(bool value, int line)
+		: value(value), line(line) {}
+
+	bool getValue() const { return value; }
+	int getLine() const override { return line; }
+
+private:
+	bool value;
 	int line;
 };
\ No newline at end of file
@@ -9,9 +9,12 @@ public:
         : expression(std::move(expression)), line(line) {}
 
     const Node *getExpression() const { return expression.get(); }
+    bool isTailCall() const { return tailCall; }
+    void setTailCall(bool isTail) { tailCall = isTail; }
     int getLine() const override { return line; }
 
 private:
     std::unique_ptr<Node> expression;
+    bool tailCall = false;
     int line;
 };
\ No newline at end of file
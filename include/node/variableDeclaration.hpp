@@ -11,6 +11,15 @@ public:
 	const std::string &getName() const { return name; }
 	const std::string &getType() const { return type; }
 	const Node *getInitializer() const { return initializer.get(); }
+	bool isStatic() const { return staticStorage; }
+	bool isConst() const { return constant; }
+	bool isThreadLocal() const { return threadLocal; }
+	void setStorage(bool isStatic, bool isConst, bool isThreadLocal)
+	{
+		staticStorage = isStatic;
+		constant = isConst;
+		threadLocal = isThreadLocal;
+	}
 	int getLine() const override { return line; }
 
 private:
@@ -18,4 +27,7 @@ private:
 	std::string type;
 	std::unique_ptr<Node> initializer;
 	int line;
+	bool staticStorage = false;
+	bool constant = false;
+	bool threadLocal = false;
 };
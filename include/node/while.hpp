@@ -1,6 +1,7 @@
 #pragma once
 
 #include "node.hpp"
+#include "attribute.hpp"
 
 class NodeWhile : public Node
 {
@@ -10,10 +11,16 @@ public:
 
     const Node *getCondition() const { return condition.get(); }
     const Node *getBody() const { return body.get(); }
+    const std::vector<Attribute> &getAttributes() const { return attributes; }
+    void setAttributes(std::vector<Attribute> attrs) { attributes = std::move(attrs); }
+    BranchHint getHint() const { return hint; }
+    void setHint(BranchHint branchHint) { hint = branchHint; }
     int getLine() const override { return line; }
 
 private:
     std::unique_ptr<Node> condition;
     std::unique_ptr<Node> body;
+    std::vector<Attribute> attributes;
+    BranchHint hint = BranchHint::None;
     int line;
 };
\ No newline at end of file
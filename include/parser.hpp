@@ -10,6 +10,7 @@
 #include "node/number.hpp"
 #include "node/string.hpp"
 #include "node/functionCall.hpp"
+#include "node/builtinCall.hpp"
 #include "node/variableDeclaration.hpp"
 #include "node/functionDeclaration.hpp"
 #include "node/return.hpp"
@@ -18,7 +19,10 @@
 #include "node/cast.hpp"
 #include "node/assignment.hpp"
 #include "node/while.hpp"
+#include "node/for.hpp"
 #include "node/ifElse.hpp"
+#include "node/match.hpp"
+#include "node/await.hpp"
 
 class Parser
 {
@@ -33,7 +37,13 @@ public:
 
 private:
 	std::unique_ptr<Node> parseExpression();
+	std::unique_ptr<Node> parseLogicalOr();
+	std::unique_ptr<Node> parseLogicalAnd();
 	std::unique_ptr<Node> parseComparison();
+	std::unique_ptr<Node> parseBitwiseOr();
+	std::unique_ptr<Node> parseBitwiseXor();
+	std::unique_ptr<Node> parseBitwiseAnd();
+	std::unique_ptr<Node> parseShift();
 	std::unique_ptr<Node> parseAdditive();
 	std::unique_ptr<Node> parseTerm();
 	std::unique_ptr<Node> parseFactor();
@@ -46,6 +56,9 @@ private:
 	std::unique_ptr<Node> parseParenthesizedExpression();
 	std::unique_ptr<Node> parseCastOperation(std::unique_ptr<Node> expr);
 	std::unique_ptr<Node> parseFunctionCall(const std::string &name, int line);
+	std::unique_ptr<Node> parseBuiltinCall();
+	std::vector<std::unique_ptr<Node>> parseCallArguments();
+	std::unique_ptr<Node> parseArrayLiteral();
 	std::unique_ptr<Node> parseArrayAccess(const std::string &name, int line);
 
 	std::string parseType();
@@ -56,12 +69,24 @@ private:
 	std::unique_ptr<Node> parseStatement();
 	std::unique_ptr<NodeBlock> parseBlock();
 	std::unique_ptr<Node> parseReturn();
+	std::unique_ptr<Node> parseBecome();
 	std::unique_ptr<Node> parseVariableDeclaration();
 	std::unique_ptr<Node> parseFunctionDeclaration();
 	std::unique_ptr<Node> parseWhileStatement();
+	std::unique_ptr<Node> parseForStatement(bool parallel = false);
+	std::unique_ptr<Node> parseParallelFor();
+	std::unique_ptr<Node> parseAsyncFunction();
+	void parseReduceClause(std::vector<NodeFor::Reduction> &reductions);
 	std::unique_ptr<Node> parseIfStatement();
+	std::unique_ptr<Node> parseMatchStatement();
+	MatchPattern parseMatchPattern();
+	int64_t parsePatternValue();
+	std::unique_ptr<Node> parseCondition(const std::string &keyword, BranchHint &hint);
+	bool parseColdMarker();
 	std::unique_ptr<Node> parseExternDeclaration();
 	std::unique_ptr<Node> parseAssignment();
+	std::vector<Attribute> parseAttributes();
+	std::unique_ptr<Node> parseAttributedStatement();
 
 	bool matchMultipleTokens(const std::vector<Token::Kind> &kinds);
 	bool matchSingleToken(Token::Kind kind);
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <functional>
+#include "node/node.hpp"
+
+// Calls visit on every direct child of node, in source order.
+void forEachChild(const Node *node, const std::function<void(const Node *)> &visit);
+
+// Calls visit on node and then, recursively, on all of its descendants.
+void walkTree(const Node *node, const std::function<void(const Node *)> &visit);
\ No newline at end of file
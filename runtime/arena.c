@@ -0,0 +1,224 @@
+#include "tvysrt.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Arenas hand out memory by bumping a cursor through a list of chunks; only the
+// chunk list and the statistics live here, the bump itself is inlined by the
+// compiler. A position is the number of bytes handed out since the arena was
+// created or reset, so a mark is just a position and releasing it pops every chunk
+// that starts past it. One popped chunk is kept as a spare so scoped allocation in a
+// loop does not go back to malloc on every iteration.
+//
+// Pools keep freed objects on an intrusive free list and carve new ones out of
+// slabs that are only returned when the pool itself is freed.
+
+#define DEFAULT_CHUNK_SIZE (64 * 1024)
+#define MAX_CHUNK_SIZE (16 * 1024 * 1024)
+#define CHUNK_ALIGN 16
+
+struct tvys_arena_chunk
+{
+    tvys_arena_chunk *prev;
+    int64_t start; // arena position of data[0]
+    int64_t size;
+    _Alignas(CHUNK_ALIGN) char data[];
+};
+
+typedef struct slab
+{
+    struct slab *next;
+} slab;
+
+static void outOfMemory(const char *what, int64_t size)
+{
+    fprintf(stderr, "%s: cannot allocate %lld bytes\n", what, (long long)size);
+    abort();
+}
+
+static int64_t position(const tvys_arena *arena)
+{
+    return arena->chunk->start + (arena->cursor - arena->chunk->data);
+}
+
+static void notePeak(tvys_arena *arena)
+{
+    const int64_t used = position(arena);
+    if (used > arena->peak)
+        arena->peak = used;
+}
+
+static tvys_arena_chunk *newChunk(int64_t size)
+{
+    tvys_arena_chunk *chunk = malloc(sizeof(tvys_arena_chunk) + (size_t)size);
+    if (!chunk)
+        outOfMemory("tvys_arena_alloc", size);
+    chunk->size = size;
+    return chunk;
+}
+
+static void pushChunk(tvys_arena *arena, tvys_arena_chunk *chunk, int64_t start)
+{
+    chunk->prev = arena->chunk;
+    chunk->start = start;
+    arena->chunk = chunk;
+    arena->cursor = chunk->data;
+    arena->limit = chunk->data + chunk->size;
+}
+
+tvys_arena *tvys_arena_new(int64_t chunkSize)
+{
+    tvys_arena *arena = calloc(1, sizeof(tvys_arena));
+    if (!arena)
+        outOfMemory("tvys_arena_new", sizeof(tvys_arena));
+    arena->chunkSize = chunkSize > 0 ? chunkSize : DEFAULT_CHUNK_SIZE;
+    pushChunk(arena, newChunk(arena->chunkSize), 0);
+    return arena;
+}
+
+void tvys_arena_free(tvys_arena *arena)
+{
+    while (arena->chunk)
+    {
+        tvys_arena_chunk *prev = arena->chunk->prev;
+        free(arena->chunk);
+        arena->chunk = prev;
+    }
+    free(arena->spare);
+    free(arena);
+}
+
+void *tvys_arena_alloc_slow(tvys_arena *arena, int64_t size, int64_t align)
+{
+    // The inlined fast path clamps overflowing sizes to INT64_MAX.
+    if (size < 0 || size > INT64_MAX / 2)
+        outOfMemory("tvys_arena_alloc", size);
+    notePeak(arena);
+
+    // Chunk data is aligned to CHUNK_ALIGN, so only stricter alignments need slack.
+    const int64_t slack = align > CHUNK_ALIGN ? align - 1 : 0;
+    const int64_t start = position(arena);
+    if (arena->spare && arena->spare->size >= size + slack)
+    {
+        pushChunk(arena, arena->spare, start);
+        arena->spare = NULL;
+    }
+    else
+    {
+        if (arena->chunkSize < MAX_CHUNK_SIZE)
+            arena->chunkSize *= 2;
+        const int64_t chunkSize = size + slack > arena->chunkSize ? size + slack : arena->chunkSize;
+        pushChunk(arena, newChunk(chunkSize), start);
+    }
+
+    uintptr_t address = (uintptr_t)arena->cursor;
+    address = (address + (uintptr_t)align - 1) & ~((uintptr_t)align - 1);
+    char *result = arena->cursor + (address - (uintptr_t)arena->cursor);
+    arena->cursor = result + size;
+    arena->allocs++;
+    return result;
+}
+
+int64_t tvys_arena_mark(tvys_arena *arena)
+{
+    return position(arena);
+}
+
+void tvys_arena_release(tvys_arena *arena, int64_t mark)
+{
+    notePeak(arena);
+    if (mark < 0 || mark > position(arena))
+    {
+        fprintf(stderr, "tvys_arena_release: mark %lld is not a position of this arena\n", (long long)mark);
+        abort();
+    }
+
+    while (arena->chunk->start > mark)
+    {
+        tvys_arena_chunk *chunk = arena->chunk;
+        arena->chunk = chunk->prev;
+        if (!arena->spare || chunk->size > arena->spare->size)
+        {
+            free(arena->spare);
+            arena->spare = chunk;
+        }
+        else
+            free(chunk);
+    }
+    arena->cursor = arena->chunk->data + (mark - arena->chunk->start);
+    arena->limit = arena->chunk->data + arena->chunk->size;
+}
+
+void tvys_arena_reset(tvys_arena *arena)
+{
+    tvys_arena_release(arena, 0);
+    arena->allocs = 0;
+}
+
+int64_t tvys_arena_used(tvys_arena *arena)
+{
+    return position(arena);
+}
+
+int64_t tvys_arena_peak(tvys_arena *arena)
+{
+    notePeak(arena);
+    return arena->peak;
+}
+
+tvys_pool *tvys_pool_new(int64_t objectSize, int64_t objectAlign)
+{
+    tvys_pool *pool = calloc(1, sizeof(tvys_pool));
+    if (!pool)
+        outOfMemory("tvys_pool_new", sizeof(tvys_pool));
+
+    // Every object must be able to hold the free-list link.
+    if (objectAlign < (int64_t)sizeof(void *))
+        objectAlign = sizeof(void *);
+    if (objectSize < (int64_t)sizeof(void *))
+        objectSize = sizeof(void *);
+    pool->objectAlign = objectAlign;
+    pool->objectSize = (objectSize + objectAlign - 1) & ~(objectAlign - 1);
+    pool->slabObjects = 16;
+    return pool;
+}
+
+void tvys_pool_free(tvys_pool *pool)
+{
+    slab *current = pool->slabs;
+    while (current)
+    {
+        slab *next = current->next;
+        free(current);
+        current = next;
+    }
+    free(pool);
+}
+
+void *tvys_pool_alloc_slow(tvys_pool *pool)
+{
+    // Slabs double up to 4096 objects; objects start after a header padded to their alignment.
+    const int64_t header = (sizeof(slab) + pool->objectAlign - 1) & ~(pool->objectAlign - 1);
+    const int64_t count = pool->slabObjects;
+    if (pool->objectSize > (INT64_MAX - header) / count)
+        outOfMemory("tvys_pool_alloc", pool->objectSize);
+    const size_t alignment = pool->objectAlign > (int64_t)sizeof(void *) ? (size_t)pool->objectAlign : sizeof(void *);
+    const size_t bytes = (size_t)(header + pool->objectSize * count);
+    slab *block = aligned_alloc(alignment, (bytes + alignment - 1) & ~(alignment - 1));
+    if (!block)
+        outOfMemory("tvys_pool_alloc", (int64_t)bytes);
+    block->next = pool->slabs;
+    pool->slabs = block;
+    if (pool->slabObjects < 4096)
+        pool->slabObjects *= 2;
+
+    // The first object is returned, the rest are threaded onto the free list.
+    char *objects = (char *)block + header;
+    for (int64_t i = count - 1; i > 0; i--)
+    {
+        void **object = (void **)(objects + i * pool->objectSize);
+        *object = pool->free;
+        pool->free = object;
+    }
+    pool->live++;
+    return objects;
+}
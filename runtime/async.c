@@ -0,0 +1,236 @@
+#include "tvysrt.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+
+// Single-threaded executor for async tasks. Runnable tasks wait in a FIFO ring;
+// tasks waiting on a descriptor are registered with epoll (one-shot) and queued
+// again once the event fires. Only the executor resumes tasks, so it is also where
+// a finished task is handed back to its waiter or, if it was spawned, destroyed.
+// Uses the clang coroutine builtins, so this file must be built with clang.
+
+static struct
+{
+    void **items;
+    size_t head;
+    size_t count;
+    size_t capacity;
+} ready;
+
+typedef struct
+{
+    void *reader;
+    void *writer;
+    int registered;
+} fdWaiters;
+
+static struct
+{
+    int epoll;
+    fdWaiters *fds;
+    size_t capacity;
+    size_t waiting;
+} io = {.epoll = -1};
+
+static void fail(const char *what)
+{
+    perror(what);
+    abort();
+}
+
+static tvys_promise_header *header(void *task)
+{
+    return (tvys_promise_header *)__builtin_coro_promise(task, TVYS_PROMISE_ALIGN, 0);
+}
+
+static void pushReady(void *task)
+{
+    if (ready.count == ready.capacity)
+    {
+        const size_t capacity = ready.capacity ? ready.capacity * 2 : 64;
+        void **items = malloc(capacity * sizeof(void *));
+        if (!items)
+            fail("tvys_run");
+        for (size_t i = 0; i < ready.count; i++)
+            items[i] = ready.items[(ready.head + i) % ready.capacity];
+        free(ready.items);
+        ready.items = items;
+        ready.head = 0;
+        ready.capacity = capacity;
+    }
+    ready.items[(ready.head + ready.count) % ready.capacity] = task;
+    ready.count++;
+}
+
+static void *popReady(void)
+{
+    void *task = ready.items[ready.head];
+    ready.head = (ready.head + 1) % ready.capacity;
+    ready.count--;
+    return task;
+}
+
+void *tvys_coro_alloc(int64_t size)
+{
+    void *frame = malloc((size_t)size);
+    if (!frame)
+        fail("tvys_coro_alloc");
+    return frame;
+}
+
+void tvys_coro_free(void *frame)
+{
+    free(frame);
+}
+
+void tvys_await_task(void *self, void *child)
+{
+    header(child)->waiter = self;
+    pushReady(child);
+}
+
+void tvys_await_yield(void *self)
+{
+    pushReady(self);
+}
+
+void tvys_spawn(void *task)
+{
+    header(task)->flags |= TVYS_TASK_DETACHED;
+    pushReady(task);
+}
+
+// Wakes every task waiting on fd; used for descriptors epoll cannot watch.
+static void wakeAll(fdWaiters *w)
+{
+    if (w->reader)
+    {
+        pushReady(w->reader);
+        io.waiting--;
+    }
+    if (w->writer)
+    {
+        pushReady(w->writer);
+        io.waiting--;
+    }
+    w->reader = w->writer = NULL;
+}
+
+static void arm(int fd)
+{
+    fdWaiters *w = &io.fds[fd];
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLONESHOT | (w->reader ? EPOLLIN : 0) | (w->writer ? EPOLLOUT : 0);
+    event.data.fd = fd;
+
+    int result = epoll_ctl(io.epoll, w->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &event);
+    // A descriptor that was closed and reopened under the same number is no longer registered.
+    if (result < 0 && errno == ENOENT && w->registered)
+        result = epoll_ctl(io.epoll, EPOLL_CTL_ADD, fd, &event);
+    if (result < 0 && errno == EPERM)
+    {
+        // Regular files are always ready.
+        wakeAll(w);
+        return;
+    }
+    if (result < 0)
+        fail("tvys_await_fd");
+    w->registered = 1;
+}
+
+void tvys_await_fd(void *self, int32_t fd, int32_t events)
+{
+    if (fd < 0)
+    {
+        errno = EBADF;
+        fail("tvys_await_fd");
+    }
+    if (io.epoll < 0 && (io.epoll = epoll_create1(EPOLL_CLOEXEC)) < 0)
+        fail("epoll_create1");
+
+    if ((size_t)fd >= io.capacity)
+    {
+        size_t capacity = io.capacity ? io.capacity : 64;
+        while (capacity <= (size_t)fd)
+            capacity *= 2;
+        fdWaiters *fds = realloc(io.fds, capacity * sizeof(fdWaiters));
+        if (!fds)
+            fail("tvys_await_fd");
+        memset(fds + io.capacity, 0, (capacity - io.capacity) * sizeof(fdWaiters));
+        io.fds = fds;
+        io.capacity = capacity;
+    }
+
+    fdWaiters *w = &io.fds[fd];
+    void **slot = events == 1 ? &w->reader : &w->writer;
+    if (*slot)
+    {
+        fprintf(stderr, "tvys_await_fd: two tasks are waiting on descriptor %d\n", fd);
+        abort();
+    }
+    *slot = self;
+    io.waiting++;
+    arm(fd);
+}
+
+static void pollIO(int timeout)
+{
+    struct epoll_event events[64];
+    const int count = epoll_wait(io.epoll, events, 64, timeout);
+    if (count < 0 && errno != EINTR)
+        fail("epoll_wait");
+
+    for (int i = 0; i < count; i++)
+    {
+        const int fd = events[i].data.fd;
+        const uint32_t mask = events[i].events;
+        fdWaiters *w = &io.fds[fd];
+
+        if (w->reader && (mask & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+        {
+            pushReady(w->reader);
+            w->reader = NULL;
+            io.waiting--;
+        }
+        if (w->writer && (mask & (EPOLLOUT | EPOLLHUP | EPOLLERR)))
+        {
+            pushReady(w->writer);
+            w->writer = NULL;
+            io.waiting--;
+        }
+        // One-shot registrations must be re-armed for a direction that is still waiting.
+        if (w->reader || w->writer)
+            arm(fd);
+    }
+}
+
+static void resume(void *task)
+{
+    __builtin_coro_resume(task);
+    if (!__builtin_coro_done(task))
+        return;
+
+    tvys_promise_header *promise = header(task);
+    if (promise->waiter)
+        pushReady(promise->waiter);
+    else if (promise->flags & TVYS_TASK_DETACHED)
+        __builtin_coro_destroy(task);
+}
+
+void tvys_run(void)
+{
+    while (ready.count > 0 || io.waiting > 0)
+    {
+        // Each batch runs only the tasks that were ready when it started, so descriptors
+        // are polled between batches even while tasks keep yielding.
+        size_t batch = ready.count;
+        while (batch-- > 0)
+            resume(popReady());
+
+        if (io.waiting > 0)
+            pollIO(ready.count > 0 ? 0 : -1);
+    }
+}
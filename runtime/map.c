@@ -0,0 +1,156 @@
+#include "tvysrt.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// File mappings for @map_file. The runtime remembers the size of every mapping it
+// made, so @unmap releases the whole file even when the slice handed to it was
+// truncated to a whole number of elements.
+
+typedef struct
+{
+    void *address;
+    size_t length;
+} mapping;
+
+static pthread_mutex_t mappingsLock = PTHREAD_MUTEX_INITIALIZER;
+static mapping *mappings;
+static size_t mappingCount;
+static size_t mappingCapacity;
+static char emptyFile;
+
+static int remember(void *address, size_t length)
+{
+    pthread_mutex_lock(&mappingsLock);
+    if (mappingCount == mappingCapacity)
+    {
+        const size_t capacity = mappingCapacity ? mappingCapacity * 2 : 16;
+        mapping *grown = realloc(mappings, capacity * sizeof(mapping));
+        if (!grown)
+        {
+            pthread_mutex_unlock(&mappingsLock);
+            return -1;
+        }
+        mappings = grown;
+        mappingCapacity = capacity;
+    }
+    mappings[mappingCount++] = (mapping){address, length};
+    pthread_mutex_unlock(&mappingsLock);
+    return 0;
+}
+
+// Returns the recorded length of the mapping at address and forgets it, or 0.
+static size_t forget(void *address)
+{
+    size_t length = 0;
+    pthread_mutex_lock(&mappingsLock);
+    for (size_t i = 0; i < mappingCount; i++)
+    {
+        if (mappings[i].address == address)
+        {
+            length = mappings[i].length;
+            mappings[i] = mappings[--mappingCount];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&mappingsLock);
+    return length;
+}
+
+// Widens [address, address + length) to whole pages, as the mm calls require.
+static void pageRange(void *address, int64_t length, void **start, size_t *size)
+{
+    const uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    const uintptr_t begin = (uintptr_t)address & ~(page - 1);
+    *start = (void *)begin;
+    *size = (size_t)((uintptr_t)address + (uintptr_t)length - begin);
+}
+
+void *tvys_map_file(const char *path, int32_t writable, int64_t *length)
+{
+    *length = 0;
+    const int fd = open(path, (writable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+
+    struct stat info;
+    if (fstat(fd, &info) < 0)
+    {
+        close(fd);
+        return NULL;
+    }
+    if (info.st_size == 0)
+    {
+        close(fd);
+        return &emptyFile;
+    }
+
+    // The mapping keeps the file referenced, so the descriptor is not needed past mmap.
+    void *address = mmap(NULL, (size_t)info.st_size, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                         writable ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+    const int error = errno;
+    close(fd);
+    if (address == MAP_FAILED)
+    {
+        errno = error;
+        return NULL;
+    }
+    if (remember(address, (size_t)info.st_size) < 0)
+    {
+        munmap(address, (size_t)info.st_size);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    *length = info.st_size;
+    return address;
+}
+
+int32_t tvys_map_advise(void *address, int64_t length, int32_t advice)
+{
+    static const int advices[] = {MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM, MADV_WILLNEED, MADV_DONTNEED};
+    if (advice < 0 || advice > TVYS_ADVISE_DONTNEED)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    if (address == &emptyFile || length <= 0)
+        return 0;
+
+    void *start;
+    size_t size;
+    pageRange(address, length, &start, &size);
+    return madvise(start, size, advices[advice]);
+}
+
+int32_t tvys_map_sync(void *address, int64_t length)
+{
+    if (address == &emptyFile || length <= 0)
+        return 0;
+
+    void *start;
+    size_t size;
+    pageRange(address, length, &start, &size);
+    return msync(start, size, MS_SYNC);
+}
+
+int32_t tvys_unmap(void *address, int64_t length)
+{
+    if (address == &emptyFile || !address)
+        return 0;
+
+    const size_t recorded = forget(address);
+    if (recorded)
+        return munmap(address, recorded);
+    if (length <= 0)
+        return 0;
+
+    void *start;
+    size_t size;
+    pageRange(address, length, &start, &size);
+    return munmap(start, size);
+}
@@ -0,0 +1,255 @@
+#include "tvysrt.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Work-stealing pool behind `parallel for`. Every worker owns a deque of index
+// ranges. Before running a range, a worker keeps splitting it in half, pushing the
+// upper half onto the bottom of its own deque, until what is left fits in the grain.
+// Idle workers steal from the top of other deques, where the largest ranges are, so
+// work spreads out in few steals and each worker mostly touches contiguous indices.
+// The thread that starts a loop takes part as worker 0.
+
+#define DEQUE_CAPACITY 128
+#define MAX_WORKERS 256
+
+typedef struct
+{
+    int64_t lo;
+    int64_t hi;
+} range;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    size_t top;
+    size_t bottom;
+    range items[DEQUE_CAPACITY];
+} deque;
+
+static struct
+{
+    int workers;
+    deque *deques;
+
+    // Workers sleep on wake between loops; generation tells them a new loop started
+    // and open whether it is still accepting helpers.
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    uint64_t generation;
+    int open;
+    atomic_int active;
+
+    // One loop runs at a time; a second thread starting one waits here.
+    pthread_mutex_t submit;
+
+    tvys_parallel_body body;
+    void *ctx;
+    int64_t grain;
+    _Atomic int64_t remaining;
+} pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER,
+    .submit = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static pthread_once_t poolOnce = PTHREAD_ONCE_INIT;
+static _Thread_local int workerIndex = -1;
+static _Thread_local unsigned victimSeed = 1;
+
+static int dequePush(deque *d, range r)
+{
+    int pushed = 0;
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom == DEQUE_CAPACITY && d->top > 0)
+    {
+        memmove(d->items, d->items + d->top, (d->bottom - d->top) * sizeof(range));
+        d->bottom -= d->top;
+        d->top = 0;
+    }
+    if (d->bottom < DEQUE_CAPACITY)
+    {
+        d->items[d->bottom++] = r;
+        pushed = 1;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return pushed;
+}
+
+// The owner takes the most recently split, smallest range from the bottom.
+static int dequePop(deque *d, range *r)
+{
+    int popped = 0;
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom > d->top)
+    {
+        *r = d->items[--d->bottom];
+        popped = 1;
+    }
+    if (d->bottom == d->top)
+        d->top = d->bottom = 0;
+    pthread_mutex_unlock(&d->lock);
+    return popped;
+}
+
+// Thieves take the oldest, largest range from the top.
+static int dequeSteal(deque *d, range *r)
+{
+    int stolen = 0;
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom > d->top)
+    {
+        *r = d->items[d->top++];
+        stolen = 1;
+    }
+    if (d->bottom == d->top)
+        d->top = d->bottom = 0;
+    pthread_mutex_unlock(&d->lock);
+    return stolen;
+}
+
+static void runRange(int self, range r)
+{
+    while (r.hi - r.lo > pool.grain)
+    {
+        const int64_t mid = r.lo + (r.hi - r.lo) / 2;
+        if (!dequePush(&pool.deques[self], (range){mid, r.hi}))
+            break;
+        r.hi = mid;
+    }
+
+    pool.body(pool.ctx, r.lo, r.hi);
+    atomic_fetch_sub(&pool.remaining, r.hi - r.lo);
+}
+
+static int stealFromOthers(int self, range *r)
+{
+    victimSeed = victimSeed * 1103515245u + 12345u;
+    const int first = (int)((victimSeed >> 16) % (unsigned)pool.workers);
+    for (int i = 0; i < pool.workers; i++)
+    {
+        const int victim = (first + i) % pool.workers;
+        if (victim != self && dequeSteal(&pool.deques[victim], r))
+            return 1;
+    }
+    return 0;
+}
+
+// Runs ranges of the current loop until every iteration has been executed.
+static void participate(int self)
+{
+    while (atomic_load(&pool.remaining) > 0)
+    {
+        range r;
+        if (dequePop(&pool.deques[self], &r) || stealFromOthers(self, &r))
+            runRange(self, r);
+        else
+            sched_yield();
+    }
+}
+
+static void *workerMain(void *arg)
+{
+    workerIndex = (int)(intptr_t)arg;
+    victimSeed = (unsigned)workerIndex * 2654435761u + 1;
+    uint64_t seen = 0;
+
+    pthread_mutex_lock(&pool.lock);
+    for (;;)
+    {
+        while (pool.generation == seen)
+            pthread_cond_wait(&pool.wake, &pool.lock);
+        seen = pool.generation;
+        if (!pool.open)
+            continue;
+
+        atomic_fetch_add(&pool.active, 1);
+        pthread_mutex_unlock(&pool.lock);
+        participate(workerIndex);
+        atomic_fetch_sub(&pool.active, 1);
+        pthread_mutex_lock(&pool.lock);
+    }
+    return NULL;
+}
+
+static void poolInit(void)
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *env = getenv("TVYS_THREADS");
+    if (env && atoi(env) > 0)
+        count = atoi(env);
+    if (count < 1)
+        count = 1;
+    if (count > MAX_WORKERS)
+        count = MAX_WORKERS;
+
+    pool.deques = calloc((size_t)count, sizeof(deque));
+    if (!pool.deques)
+        count = 1;
+    pool.workers = (int)count;
+
+    for (int i = 0; i < pool.workers; i++)
+        pthread_mutex_init(&pool.deques[i].lock, NULL);
+
+    for (int i = 1; i < pool.workers; i++)
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, workerMain, (void *)(intptr_t)i) != 0)
+        {
+            pool.workers = i;
+            break;
+        }
+        pthread_detach(thread);
+    }
+}
+
+void tvys_parallel_for(tvys_parallel_body body, void *ctx, int64_t start, int64_t end, int64_t grain)
+{
+    if (start >= end)
+        return;
+    pthread_once(&poolOnce, poolInit);
+
+    // Loops nested in a parallel body, and loops that fit in one chunk, run on the calling thread.
+    const int64_t count = end - start;
+    if (workerIndex >= 0 || pool.workers == 1 || (grain > 0 && count <= grain))
+    {
+        body(ctx, start, end);
+        return;
+    }
+    if (grain <= 0)
+    {
+        grain = count / ((int64_t)pool.workers * 8);
+        if (grain < 1)
+            grain = 1;
+    }
+
+    pthread_mutex_lock(&pool.submit);
+    workerIndex = 0;
+    pool.body = body;
+    pool.ctx = ctx;
+    pool.grain = grain;
+    atomic_store(&pool.remaining, count);
+    dequePush(&pool.deques[0], (range){start, end});
+
+    pthread_mutex_lock(&pool.lock);
+    pool.open = 1;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.wake);
+    pthread_mutex_unlock(&pool.lock);
+
+    participate(0);
+
+    // Once closed, no worker can join; waiting for the ones still inside participate
+    // guarantees none touches this loop's context after we return.
+    pthread_mutex_lock(&pool.lock);
+    pool.open = 0;
+    pthread_mutex_unlock(&pool.lock);
+    while (atomic_load(&pool.active) > 0)
+        sched_yield();
+
+    workerIndex = -1;
+    pthread_mutex_unlock(&pool.submit);
+}
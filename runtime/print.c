@@ -0,0 +1,199 @@
+#include "tvysrt.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// tvys_print_int and friends, which programs call as printInt and so on, format into
+// a per-thread buffer instead of calling printf, so output-heavy programs make one
+// write(2) per buffer rather than one formatted call per value. Every buffer is kept
+// in a list so the exit handler can flush the ones owned by threads that are still
+// running; each has its own lock, which only the exit handler ever contends for.
+
+#define BUFFER_SIZE 65536
+
+typedef struct outputBuffer
+{
+    struct outputBuffer *next;
+    struct outputBuffer *prev;
+    pthread_mutex_t lock;
+    size_t length;
+    char data[BUFFER_SIZE];
+} outputBuffer;
+
+static pthread_mutex_t buffersLock = PTHREAD_MUTEX_INITIALIZER;
+static outputBuffer *buffers;
+static pthread_key_t bufferKey;
+static pthread_once_t bufferOnce = PTHREAD_ONCE_INIT;
+static int lineBuffered;
+static _Thread_local outputBuffer *current;
+
+static const char digitPairs[201] = "00010203040506070809"
+                                    "10111213141516171819"
+                                    "20212223242526272829"
+                                    "30313233343536373839"
+                                    "40414243444546474849"
+                                    "50515253545556575859"
+                                    "60616263646566676869"
+                                    "70717273747576777879"
+                                    "80818283848586878889"
+                                    "90919293949596979899";
+
+static void writeAll(const char *data, size_t length)
+{
+    while (length > 0)
+    {
+        const ssize_t written = write(STDOUT_FILENO, data, length);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+}
+
+static void drain(outputBuffer *buffer)
+{
+    writeAll(buffer->data, buffer->length);
+    buffer->length = 0;
+}
+
+static void drainLocked(outputBuffer *buffer)
+{
+    pthread_mutex_lock(&buffer->lock);
+    drain(buffer);
+    pthread_mutex_unlock(&buffer->lock);
+}
+
+static void flushAll(void)
+{
+    pthread_mutex_lock(&buffersLock);
+    for (outputBuffer *buffer = buffers; buffer; buffer = buffer->next)
+        drainLocked(buffer);
+    pthread_mutex_unlock(&buffersLock);
+}
+
+static void threadExit(void *arg)
+{
+    outputBuffer *buffer = arg;
+    drainLocked(buffer);
+    pthread_mutex_lock(&buffersLock);
+    if (buffer->prev)
+        buffer->prev->next = buffer->next;
+    else
+        buffers = buffer->next;
+    if (buffer->next)
+        buffer->next->prev = buffer->prev;
+    pthread_mutex_unlock(&buffersLock);
+    pthread_mutex_destroy(&buffer->lock);
+    free(buffer);
+}
+
+static void bufferInit(void)
+{
+    pthread_key_create(&bufferKey, threadExit);
+    lineBuffered = isatty(STDOUT_FILENO);
+    atexit(flushAll);
+}
+
+static outputBuffer *getBuffer(void)
+{
+    if (current)
+        return current;
+
+    pthread_once(&bufferOnce, bufferInit);
+    outputBuffer *buffer = malloc(sizeof(outputBuffer));
+    if (!buffer)
+        abort();
+    pthread_mutex_init(&buffer->lock, NULL);
+    buffer->length = 0;
+    buffer->prev = NULL;
+
+    pthread_mutex_lock(&buffersLock);
+    buffer->next = buffers;
+    if (buffers)
+        buffers->prev = buffer;
+    buffers = buffer;
+    pthread_mutex_unlock(&buffersLock);
+
+    pthread_setspecific(bufferKey, buffer);
+    return current = buffer;
+}
+
+// On a terminal, output is written at the end of each line.
+static void append(const char *data, size_t length)
+{
+    outputBuffer *buffer = getBuffer();
+    pthread_mutex_lock(&buffer->lock);
+    if (buffer->length + length > BUFFER_SIZE)
+    {
+        drain(buffer);
+        if (length > BUFFER_SIZE)
+        {
+            writeAll(data, length);
+            data += length;
+            length = 0;
+        }
+    }
+    memcpy(buffer->data + buffer->length, data, length);
+    buffer->length += length;
+    if (lineBuffered && length > 0 && data[length - 1] == '\n')
+        drain(buffer);
+    pthread_mutex_unlock(&buffer->lock);
+}
+
+// Formats the value followed by a newline so that it ends at end, two digits at a
+// time, and returns where the text starts.
+static char *formatLine(uint64_t magnitude, int negative, char *end)
+{
+    char *p = end;
+    *--p = '\n';
+    while (magnitude >= 100)
+    {
+        const unsigned pair = (unsigned)(magnitude % 100) * 2;
+        magnitude /= 100;
+        p -= 2;
+        memcpy(p, digitPairs + pair, 2);
+    }
+    if (magnitude >= 10)
+    {
+        p -= 2;
+        memcpy(p, digitPairs + magnitude * 2, 2);
+    }
+    else
+        *--p = (char)('0' + magnitude);
+    if (negative)
+        *--p = '-';
+    return p;
+}
+
+void tvys_print_i64(int64_t value)
+{
+    char text[24];
+    char *end = text + sizeof(text);
+    // Negating in unsigned arithmetic keeps INT64_MIN well defined.
+    const uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+    char *start = formatLine(magnitude, value < 0, end);
+    append(start, (size_t)(end - start));
+}
+
+void tvys_print_int(int32_t value)
+{
+    tvys_print_i64(value);
+}
+
+void tvys_print_str(const char *text)
+{
+    const size_t length = strlen(text);
+    append(text, length);
+    append("\n", 1);
+}
+
+void tvys_flush(void)
+{
+    drainLocked(getBuffer());
+}
@@ -0,0 +1,374 @@
+#include "tvysrt.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Patches the sleds LLVM emits for "function-instrument"="xray-always", using the
+// same x86-64 sequences as compiler-rt's XRay but without its runtime. Sleds are
+// listed in the xray_instr_map section and names come from tvys_prof_map, which
+// the compiler fills after optimization so only functions that survived inlining
+// appear. While disabled an entry sled is a two-byte jump over nine bytes of NOPs
+// and an exit sled is a ret followed by NOPs.
+//
+// Enabled, an entry sled becomes `mov $id, %r10d; call entryTrampoline` and an exit
+// sled `mov $id, %r10d; jmp exitTrampoline`; the trampolines save the registers the
+// function uses for arguments or results and call the handler. Each thread keeps a
+// shadow stack of the functions it is in, so a function's time can be split into
+// its own (self) and that of its callees.
+
+#if defined(__x86_64__)
+
+enum
+{
+    SLED_ENTRY = 0,
+    SLED_EXIT = 1,
+    SLED_TAIL = 2,
+};
+
+typedef struct
+{
+    uint64_t address;
+    uint64_t function;
+    unsigned char kind;
+    unsigned char alwaysInstrument;
+    unsigned char version;
+    unsigned char padding[13];
+} sledEntry;
+
+extern const sledEntry __start_xray_instr_map[] __attribute__((weak, visibility("hidden")));
+extern const sledEntry __stop_xray_instr_map[] __attribute__((weak, visibility("hidden")));
+extern const tvys_prof_entry __start_tvys_prof_map[] __attribute__((weak, visibility("hidden")));
+extern const tvys_prof_entry __stop_tvys_prof_map[] __attribute__((weak, visibility("hidden")));
+
+// Version 2 sleds store addresses relative to the field holding them.
+static uintptr_t sledAddress(const sledEntry *sled)
+{
+    return sled->version < 2 ? sled->address : (uintptr_t)&sled->address + sled->address;
+}
+
+static uintptr_t sledFunction(const sledEntry *sled)
+{
+    return sled->version < 2 ? sled->function : (uintptr_t)&sled->function + sled->function;
+}
+
+typedef struct
+{
+    uintptr_t address;
+    const char *name;
+    _Atomic uint64_t calls;
+    _Atomic uint64_t selfCycles;
+    _Atomic uint64_t totalCycles;
+} functionStats;
+
+#define MAX_DEPTH 256
+
+typedef struct
+{
+    int32_t id;
+    uint64_t start;
+    uint64_t callees;
+} frame;
+
+static struct
+{
+    pthread_mutex_t lock;
+    int initialized;
+    int enabled;
+    int reportRegistered;
+    functionStats *functions;
+    size_t count;
+} profile = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+static _Thread_local frame stack[MAX_DEPTH];
+// May exceed MAX_DEPTH; frames past it are counted but not timed.
+static _Thread_local int depth;
+
+static void handleEvent(int32_t id, int32_t kind)
+{
+    const uint64_t now = __builtin_ia32_rdtsc();
+    functionStats *stats = &profile.functions[id];
+
+    if (kind == SLED_ENTRY)
+    {
+        atomic_fetch_add_explicit(&stats->calls, 1, memory_order_relaxed);
+        if (depth < MAX_DEPTH)
+            stack[depth] = (frame){id, now, 0};
+        depth++;
+        return;
+    }
+
+    // Functions already running when profiling was enabled return without an entry.
+    if (depth == 0)
+        return;
+    depth--;
+    if (depth >= MAX_DEPTH || stack[depth].id != id)
+        return;
+
+    const uint64_t elapsed = now - stack[depth].start;
+    atomic_fetch_add_explicit(&stats->totalCycles, elapsed, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stats->selfCycles, elapsed - stack[depth].callees, memory_order_relaxed);
+    if (depth > 0 && depth <= MAX_DEPTH)
+        stack[depth - 1].callees += elapsed;
+}
+
+void tvysProfileEvent(int32_t id, int32_t kind) __attribute__((visibility("hidden"), used));
+void tvysProfileEvent(int32_t id, int32_t kind)
+{
+    handleEvent(id, kind);
+}
+
+// The stack is realigned because sleds run before the prologue and after the epilogue.
+#define SAVE_ARGUMENTS                \
+    "push %rbp\n"                     \
+    "mov %rsp, %rbp\n"                \
+    "and $-16, %rsp\n"                \
+    "sub $192, %rsp\n"                \
+    "movdqu %xmm0, 0(%rsp)\n"         \
+    "movdqu %xmm1, 16(%rsp)\n"        \
+    "movdqu %xmm2, 32(%rsp)\n"        \
+    "movdqu %xmm3, 48(%rsp)\n"        \
+    "movdqu %xmm4, 64(%rsp)\n"        \
+    "movdqu %xmm5, 80(%rsp)\n"        \
+    "movdqu %xmm6, 96(%rsp)\n"        \
+    "movdqu %xmm7, 112(%rsp)\n"       \
+    "mov %rdi, 128(%rsp)\n"           \
+    "mov %rsi, 136(%rsp)\n"           \
+    "mov %rdx, 144(%rsp)\n"           \
+    "mov %rcx, 152(%rsp)\n"           \
+    "mov %r8, 160(%rsp)\n"            \
+    "mov %r9, 168(%rsp)\n"            \
+    "mov %rax, 176(%rsp)\n"
+
+#define RESTORE_ARGUMENTS             \
+    "movdqu 0(%rsp), %xmm0\n"         \
+    "movdqu 16(%rsp), %xmm1\n"        \
+    "movdqu 32(%rsp), %xmm2\n"        \
+    "movdqu 48(%rsp), %xmm3\n"        \
+    "movdqu 64(%rsp), %xmm4\n"        \
+    "movdqu 80(%rsp), %xmm5\n"        \
+    "movdqu 96(%rsp), %xmm6\n"        \
+    "movdqu 112(%rsp), %xmm7\n"       \
+    "mov 128(%rsp), %rdi\n"           \
+    "mov 136(%rsp), %rsi\n"           \
+    "mov 144(%rsp), %rdx\n"           \
+    "mov 152(%rsp), %rcx\n"           \
+    "mov 160(%rsp), %r8\n"            \
+    "mov 168(%rsp), %r9\n"            \
+    "mov 176(%rsp), %rax\n"           \
+    "mov %rbp, %rsp\n"                \
+    "pop %rbp\n"
+
+#define TRAMPOLINE(name, kind)                \
+    ".pushsection .text\n"                    \
+    ".p2align 4\n"                            \
+    ".local " #name "\n"                      \
+    ".type " #name ", @function\n"            \
+    #name ":\n" SAVE_ARGUMENTS                \
+    "mov %r10d, %edi\n"                       \
+    "mov $" #kind ", %esi\n"                  \
+    "call tvysProfileEvent\n" RESTORE_ARGUMENTS \
+    "ret\n"                                   \
+    ".size " #name ", . - " #name "\n"         \
+    ".popsection\n"
+
+// Exit sleds jump here in place of the function's ret, so this ret returns to its caller.
+__asm__(TRAMPOLINE(tvysEntryTrampoline, 0) TRAMPOLINE(tvysExitTrampoline, 1) TRAMPOLINE(tvysTailTrampoline, 2));
+
+extern char tvysEntryTrampoline[] __attribute__((visibility("hidden")));
+extern char tvysExitTrampoline[] __attribute__((visibility("hidden")));
+extern char tvysTailTrampoline[] __attribute__((visibility("hidden")));
+
+static int compareStats(const void *a, const void *b)
+{
+    const uintptr_t left = ((const functionStats *)a)->address;
+    const uintptr_t right = ((const functionStats *)b)->address;
+    return left < right ? -1 : left > right;
+}
+
+static functionStats *findFunction(uintptr_t address)
+{
+    functionStats key = {.address = address};
+    return bsearch(&key, profile.functions, profile.count, sizeof(functionStats), compareStats);
+}
+
+static void buildTable(void)
+{
+    const size_t sleds = (size_t)(__stop_xray_instr_map - __start_xray_instr_map);
+    profile.functions = calloc(sleds ? sleds : 1, sizeof(functionStats));
+    if (!profile.functions)
+        return;
+
+    for (size_t i = 0; i < sleds; i++)
+        profile.functions[i].address = sledFunction(&__start_xray_instr_map[i]);
+    qsort(profile.functions, sleds, sizeof(functionStats), compareStats);
+
+    size_t unique = 0;
+    for (size_t i = 0; i < sleds; i++)
+    {
+        if (unique == 0 || profile.functions[unique - 1].address != profile.functions[i].address)
+            profile.functions[unique++].address = profile.functions[i].address;
+    }
+    profile.count = unique;
+
+    for (const tvys_prof_entry *entry = __start_tvys_prof_map; entry < __stop_tvys_prof_map; entry++)
+    {
+        functionStats *stats = findFunction((uintptr_t)entry->function);
+        if (stats)
+            stats->name = entry->name;
+    }
+}
+
+static int writeCode(uintptr_t address, const unsigned char *code, size_t length, uint16_t head)
+{
+    const uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    const uintptr_t first = address & ~(page - 1);
+    const size_t size = (address + length + page - 1) / page * page - first;
+    if (mprotect((void *)first, size, PROT_READ | PROT_WRITE | PROT_EXEC) < 0)
+        return -1;
+
+    // The tail is written first and the first two bytes last, in one store, so a thread
+    // running through the sled sees either the old or the new sequence.
+    memcpy((void *)(address + 2), code + 2, length - 2);
+    __atomic_store_n((uint16_t *)address, head, __ATOMIC_RELEASE);
+    return mprotect((void *)first, size, PROT_READ | PROT_EXEC);
+}
+
+static int patchSled(const sledEntry *sled, int enable)
+{
+    const uintptr_t address = sledAddress(sled);
+    functionStats *stats = findFunction(sledFunction(sled));
+    if (!stats)
+        return -1;
+    const int32_t id = (int32_t)(stats - profile.functions);
+
+    unsigned char code[11];
+    if (!enable)
+    {
+        // jmp +9, or ret; nop
+        return writeCode(address, code, 2, sled->kind == SLED_EXIT ? 0x90c3 : 0x09eb);
+    }
+
+    const char *trampoline = sled->kind == SLED_ENTRY ? tvysEntryTrampoline
+                           : sled->kind == SLED_EXIT  ? tvysExitTrampoline
+                                                      : tvysTailTrampoline;
+    const int64_t offset = (int64_t)(uintptr_t)trampoline - (int64_t)(address + 11);
+    if (offset < INT32_MIN || offset > INT32_MAX)
+        return -1;
+
+    // mov $id, %r10d (41 ba imm32), then call or jmp rel32
+    memcpy(code + 2, &id, 4);
+    code[6] = sled->kind == SLED_EXIT ? 0xe9 : 0xe8;
+    const int32_t relative = (int32_t)offset;
+    memcpy(code + 7, &relative, 4);
+    return writeCode(address, code, sizeof(code), 0xba41);
+}
+
+static void report(void)
+{
+    if (!profile.count)
+        return;
+
+    functionStats *sorted = malloc(profile.count * sizeof(functionStats));
+    if (!sorted)
+        return;
+    memcpy(sorted, profile.functions, profile.count * sizeof(functionStats));
+
+    uint64_t selfTotal = 0;
+    for (size_t i = 0; i < profile.count; i++)
+        selfTotal += sorted[i].selfCycles;
+
+    // Sorted by self time, most expensive first.
+    for (size_t i = 1; i < profile.count; i++)
+    {
+        functionStats current = sorted[i];
+        size_t j = i;
+        for (; j > 0 && sorted[j - 1].selfCycles < current.selfCycles; j--)
+            sorted[j] = sorted[j - 1];
+        sorted[j] = current;
+    }
+
+    fprintf(stderr, "\n%12s %16s %16s %12s %7s  %s\n", "calls", "self cycles", "total cycles", "cycles/call", "self %", "function");
+    for (size_t i = 0; i < profile.count; i++)
+    {
+        const functionStats *stats = &sorted[i];
+        if (!stats->calls)
+            continue;
+        fprintf(stderr, "%12llu %16llu %16llu %12llu %6.2f%%  ", (unsigned long long)stats->calls,
+                (unsigned long long)stats->selfCycles, (unsigned long long)stats->totalCycles,
+                (unsigned long long)(stats->totalCycles / stats->calls),
+                selfTotal ? 100.0 * (double)stats->selfCycles / (double)selfTotal : 0.0);
+        if (stats->name)
+            fprintf(stderr, "%s\n", stats->name);
+        else
+            fprintf(stderr, "%p\n", (void *)stats->address);
+    }
+    free(sorted);
+}
+
+static int setEnabled(int enable)
+{
+    pthread_mutex_lock(&profile.lock);
+    int result = 0;
+    if (!profile.initialized)
+    {
+        buildTable();
+        profile.initialized = 1;
+    }
+    if (!profile.functions)
+        result = -1;
+    else if (profile.enabled != enable)
+    {
+        for (const sledEntry *sled = __start_xray_instr_map; sled < __stop_xray_instr_map; sled++)
+        {
+            if ((sled->kind == SLED_ENTRY || sled->kind == SLED_EXIT || sled->kind == SLED_TAIL) && patchSled(sled, enable) < 0)
+                result = -1;
+        }
+        profile.enabled = enable;
+        if (enable && !profile.reportRegistered)
+        {
+            atexit(report);
+            profile.reportRegistered = 1;
+        }
+    }
+    pthread_mutex_unlock(&profile.lock);
+    return result;
+}
+
+int32_t tvys_prof_enable(void)
+{
+    return setEnabled(1);
+}
+
+int32_t tvys_prof_disable(void)
+{
+    return setEnabled(0);
+}
+
+void tvys_prof_init(void)
+{
+    const char *env = getenv("TVYS_PROFILE");
+    if (env && atoi(env) > 0 && tvys_prof_enable() < 0)
+        perror("tvys_prof_enable");
+}
+
+#else
+
+void tvys_prof_init(void)
+{
+}
+
+int32_t tvys_prof_enable(void)
+{
+    return -1;
+}
+
+int32_t tvys_prof_disable(void)
+{
+    return -1;
+}
+
+#endif
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <stdint.h>
+
+// Support library linked into compiled Toornvys programs (libtvysrt.a).
+
+// Body of an outlined parallel for: runs the iterations in [lo, hi).
+typedef void (*tvys_parallel_body)(void *ctx, int64_t lo, int64_t hi);
+
+// Runs body over [start, end) on the worker pool, in chunks of at most grain
+// iterations (0 picks a grain from the trip count), and returns once every
+// iteration has run. The pool size is the number of online CPUs unless
+// TVYS_THREADS is set.
+void tvys_parallel_for(tvys_parallel_body body, void *ctx, int64_t start, int64_t end, int64_t grain);
+
+// Async tasks. A task is the handle of a suspended coroutine frame whose promise
+// starts with tvys_promise_header.
+typedef struct
+{
+    void *waiter;
+    int32_t flags;
+} tvys_promise_header;
+
+#define TVYS_PROMISE_ALIGN 8
+#define TVYS_TASK_DETACHED 1
+
+void *tvys_coro_alloc(int64_t size);
+void tvys_coro_free(void *frame);
+
+// Called by a task right before it suspends: resume self once child has finished,
+// once fd is ready (events: 1 = readable, 2 = writable), or on the next turn.
+void tvys_await_task(void *self, void *child);
+void tvys_await_fd(void *self, int32_t fd, int32_t events);
+void tvys_await_yield(void *self);
+
+// Queues a task to run detached; its frame is freed when it finishes.
+void tvys_spawn(void *task);
+
+// Runs queued tasks on the calling thread until none is runnable or waiting on a descriptor.
+void tvys_run(void);
+
+// Buffered output. Each thread appends to its own buffer, which is written to
+// stdout with write(2) when full, on tvys_flush(), when the thread exits and at program
+// exit; on a terminal it is also written at the end of every line. Output from
+// other routes to stdout (printf, write) is not ordered with respect to it.
+// Programs call these as printInt, printI64, printStr and flush unless they define
+// functions of those names themselves.
+void tvys_print_int(int32_t value);
+void tvys_print_i64(int64_t value);
+void tvys_print_str(const char *text);
+void tvys_flush(void);
+
+// Arenas and pools. Generated code inlines the fast paths, so the leading fields of
+// both structs are part of the ABI between the compiler and the runtime.
+typedef struct tvys_arena_chunk tvys_arena_chunk;
+
+typedef struct
+{
+    char *cursor; // next free byte of the current chunk
+    char *limit;  // end of the current chunk
+    int64_t allocs;
+
+    tvys_arena_chunk *chunk;
+    tvys_arena_chunk *spare;
+    int64_t chunkSize;
+    int64_t peak;
+} tvys_arena;
+
+typedef struct
+{
+    void *free; // singly linked through the first word of each free object
+    int64_t live;
+
+    int64_t objectSize;
+    int64_t objectAlign;
+    void *slabs;
+    int64_t slabObjects;
+} tvys_pool;
+
+// chunkSize is the size of the first chunk, 0 for the default; later chunks double.
+tvys_arena *tvys_arena_new(int64_t chunkSize);
+void tvys_arena_free(tvys_arena *arena);
+// Called when an allocation does not fit in the current chunk.
+void *tvys_arena_alloc_slow(tvys_arena *arena, int64_t size, int64_t align);
+// A mark is a position in the arena; releasing it frees everything allocated since.
+int64_t tvys_arena_mark(tvys_arena *arena);
+void tvys_arena_release(tvys_arena *arena, int64_t mark);
+void tvys_arena_reset(tvys_arena *arena);
+// Bytes currently allocated, including alignment padding, and their high-water mark.
+int64_t tvys_arena_used(tvys_arena *arena);
+int64_t tvys_arena_peak(tvys_arena *arena);
+
+tvys_pool *tvys_pool_new(int64_t objectSize, int64_t objectAlign);
+void tvys_pool_free(tvys_pool *pool);
+// Called when the free list is empty.
+void *tvys_pool_alloc_slow(tvys_pool *pool);
+
+// Memory-mapped files. tvys_map_file maps the whole file, shared and writable or
+// private and read-only, stores its size in *length and returns its address, or NULL
+// with errno set. An empty file maps to a non-NULL address of length 0.
+void *tvys_map_file(const char *path, int32_t writable, int64_t *length);
+
+#define TVYS_ADVISE_NORMAL 0
+#define TVYS_ADVISE_SEQUENTIAL 1
+#define TVYS_ADVISE_RANDOM 2
+#define TVYS_ADVISE_WILLNEED 3
+#define TVYS_ADVISE_DONTNEED 4
+
+// These take any byte range inside a mapping and return 0, or -1 with errno set.
+int32_t tvys_map_advise(void *address, int64_t length, int32_t advice);
+int32_t tvys_map_sync(void *address, int64_t length);
+// Unmapping the address tvys_map_file returned releases the whole file, whatever length says.
+int32_t tvys_unmap(void *address, int64_t length);
+
+// Function profiling for code compiled with --instrument-functions=xray. Every
+// instrumented function carries XRay entry and exit sleds, which stay NOPs until
+// enabled. Enabling patches them to count calls and accumulate TSC cycles per
+// function; the results are printed to stderr at exit, most expensive first.
+// Setting TVYS_PROFILE=1 enables profiling at startup. x86-64 only.
+typedef struct
+{
+    const void *function;
+    const char *name;
+} tvys_prof_entry;
+
+// Called from a constructor in every instrumented object.
+void tvys_prof_init(void);
+// Return 0 on success, -1 if the sleds could not be patched.
+int32_t tvys_prof_enable(void);
+int32_t tvys_prof_disable(void);
@@ -0,0 +1,265 @@
+#include "../include/codegen.hpp"
+#include "../include/error.hpp"
+
+// An async fn is a switched-resume coroutine built on the llvm.coro intrinsics; the
+// CoroSplit pass later turns it into a frame plus resume and destroy functions. Calling
+// one allocates the frame and returns its handle without running the body: the task
+// starts once it is awaited or spawned. The promise starts with a header shared with
+// the runtime, {ptr waiter, i32 flags}, followed by the result. A finished task stays
+// suspended at its final point until whoever awaited it has read the result and
+// destroyed the frame; spawned tasks are destroyed by the executor.
+
+static const unsigned PromiseAlign = 8;
+
+llvm::StructType *CodeGenerator::getPromiseType(llvm::Type *resultType)
+{
+    std::vector<llvm::Type *> fields = {builder.getPtrTy(), builder.getInt32Ty()};
+    if (!resultType->isVoidTy())
+        fields.push_back(resultType);
+    return llvm::StructType::get(context, fields);
+}
+
+// "task" is the handle of an async fn returning void, "task<T>" of one returning T.
+llvm::Type *CodeGenerator::getTaskResultType(const std::string &typeName)
+{
+    if (typeName == "task")
+        return builder.getVoidTy();
+    if (typeName.rfind("task<", 0) != 0 || typeName.back() != '>')
+        return nullptr;
+    return getLLVMType(typeName.substr(5, typeName.size() - 6));
+}
+
+// The result of awaiting operand: the async fn's result for a call, the declared result
+// for a task variable, nullptr if neither says.
+llvm::Type *CodeGenerator::getAwaitResultType(const Node *operand)
+{
+    if (auto call = dynamic_cast<const NodeFunctionCall *>(operand))
+    {
+        auto it = asyncResultTypes.find(call->getName());
+        return it != asyncResultTypes.end() ? it->second : nullptr;
+    }
+    if (auto id = dynamic_cast<const NodeIdentifier *>(operand))
+    {
+        const SymbolTable::Symbol *sym = symbolTable.lookupVariable(id->getName());
+        return sym ? getTaskResultType(sym->baseType) : nullptr;
+    }
+    return nullptr;
+}
+
+// Storing a task in a variable of another task type would make the await read the
+// promise at the wrong type.
+void CodeGenerator::checkTaskValue(const std::string &typeName, const Node *value, int line)
+{
+    llvm::Type *declared = getTaskResultType(typeName);
+    if (!declared)
+        return;
+    auto call = dynamic_cast<const NodeFunctionCall *>(value);
+    auto id = dynamic_cast<const NodeIdentifier *>(value);
+    if (!call && !id)
+        return;
+    if (call && !asyncResultTypes.count(call->getName()))
+        return;
+    llvm::Type *actual = getAwaitResultType(value);
+    if (id && !actual)
+        ERROR(line, "Variable '%s' is not a task", id->getName().c_str());
+    if (actual != declared)
+        ERROR(line, "Type mismatch: the task's result type does not match %s", typeName.c_str());
+}
+
+void CodeGenerator::beginCoroutine(llvm::Function *function, llvm::Type *resultType, int line)
+{
+    // Results are read back through the runtime's fixed promise alignment.
+    const bool scalar = resultType->isIntegerTy() || resultType->isFloatingPointTy() || resultType->isPointerTy();
+    if (!resultType->isVoidTy() && (!scalar || module->getDataLayout().getABITypeAlign(resultType).value() > PromiseAlign))
+        ERROR(line, "An async fn must return void, an integer, a floating-point value or a pointer");
+
+    function->setPresplitCoroutine();
+    coroutine.resultType = resultType;
+    coroutine.promiseType = getPromiseType(resultType);
+    coroutine.promise = createEntryBlockAlloca(function, "promise", coroutine.promiseType);
+    coroutine.promise->setAlignment(llvm::Align(PromiseAlign));
+
+    llvm::Value *null = llvm::ConstantPointerNull::get(builder.getPtrTy());
+    coroutine.id = builder.CreateIntrinsic(llvm::Intrinsic::coro_id, {}, {builder.getInt32(PromiseAlign), coroutine.promise, null, null}, nullptr, "coro.id");
+    llvm::Value *needsFrame = builder.CreateIntrinsic(llvm::Intrinsic::coro_alloc, {}, {coroutine.id}, nullptr, "coro.needs.frame");
+
+    // The frame is only allocated when CoroElide cannot place it in the caller's frame.
+    llvm::BasicBlock *entryBlock = builder.GetInsertBlock();
+    llvm::BasicBlock *allocBlock = llvm::BasicBlock::Create(context, "coro.alloc", function);
+    llvm::BasicBlock *beginBlock = llvm::BasicBlock::Create(context, "coro.begin", function);
+    builder.CreateCondBr(needsFrame, allocBlock, beginBlock);
+
+    builder.SetInsertPoint(allocBlock);
+    llvm::FunctionCallee allocFrame = module->getOrInsertFunction("tvys_coro_alloc", builder.getPtrTy(), builder.getInt64Ty());
+    llvm::Value *size = builder.CreateIntrinsic(llvm::Intrinsic::coro_size, {builder.getInt64Ty()}, {}, nullptr, "coro.size");
+    llvm::Value *allocated = builder.CreateCall(allocFrame, {size}, "coro.mem");
+    builder.CreateBr(beginBlock);
+
+    builder.SetInsertPoint(beginBlock);
+    llvm::PHINode *memory = builder.CreatePHI(builder.getPtrTy(), 2, "coro.frame");
+    memory->addIncoming(null, entryBlock);
+    memory->addIncoming(allocated, allocBlock);
+    coroutine.handle = builder.CreateIntrinsic(llvm::Intrinsic::coro_begin, {}, {coroutine.id, memory}, nullptr, "coro.handle");
+    builder.CreateStore(llvm::Constant::getNullValue(coroutine.promiseType), coroutine.promise);
+
+    coroutine.finalBlock = llvm::BasicBlock::Create(context, "coro.final", function);
+    coroutine.cleanupBlock = llvm::BasicBlock::Create(context, "coro.cleanup", function);
+    coroutine.suspendBlock = llvm::BasicBlock::Create(context, "coro.suspend", function);
+
+    emitSuspend("coro.start");
+}
+
+void CodeGenerator::emitSuspend(const std::string &resumeName)
+{
+    llvm::Function *function = builder.GetInsertBlock()->getParent();
+    llvm::Value *state = builder.CreateIntrinsic(llvm::Intrinsic::coro_suspend, {}, {llvm::ConstantTokenNone::get(context), builder.getFalse()}, nullptr, "coro.state");
+
+    // 0 resumes, 1 destroys, anything else returns to whoever resumed the task.
+    llvm::BasicBlock *resumeBlock = llvm::BasicBlock::Create(context, resumeName, function);
+    llvm::SwitchInst *dispatch = builder.CreateSwitch(state, coroutine.suspendBlock, 2);
+    dispatch->addCase(builder.getInt8(0), resumeBlock);
+    dispatch->addCase(builder.getInt8(1), coroutine.cleanupBlock);
+    builder.SetInsertPoint(resumeBlock);
+}
+
+void CodeGenerator::finishCoroutine()
+{
+    llvm::Function *function = coroutine.finalBlock->getParent();
+
+    // Resuming a task past its final suspend point is a bug in the executor.
+    builder.SetInsertPoint(coroutine.finalBlock);
+    llvm::Value *state = builder.CreateIntrinsic(llvm::Intrinsic::coro_suspend, {}, {llvm::ConstantTokenNone::get(context), builder.getTrue()}, nullptr, "coro.final.state");
+    llvm::BasicBlock *trapBlock = llvm::BasicBlock::Create(context, "coro.resumed.after.final", function);
+    llvm::SwitchInst *dispatch = builder.CreateSwitch(state, coroutine.suspendBlock, 2);
+    dispatch->addCase(builder.getInt8(0), trapBlock);
+    dispatch->addCase(builder.getInt8(1), coroutine.cleanupBlock);
+
+    builder.SetInsertPoint(trapBlock);
+    builder.CreateIntrinsic(llvm::Intrinsic::trap, {}, {});
+    builder.CreateUnreachable();
+
+    builder.SetInsertPoint(coroutine.cleanupBlock);
+    llvm::FunctionCallee freeFrame = module->getOrInsertFunction("tvys_coro_free", builder.getVoidTy(), builder.getPtrTy());
+    llvm::Value *memory = builder.CreateIntrinsic(llvm::Intrinsic::coro_free, {}, {coroutine.id, coroutine.handle}, nullptr, "coro.mem");
+    builder.CreateCall(freeFrame, {memory});
+    builder.CreateBr(coroutine.suspendBlock);
+
+    builder.SetInsertPoint(coroutine.suspendBlock);
+    builder.CreateIntrinsic(llvm::Intrinsic::coro_end, {}, {coroutine.handle, builder.getFalse(), llvm::ConstantTokenNone::get(context)});
+    builder.CreateRet(coroutine.handle);
+
+    coroutine = CoroutineState();
+}
+
+void CodeGenerator::generateAsyncReturn(const NodeReturn *node)
+{
+    if (node->isTailCall())
+        ERROR(node->getLine(), "'become' cannot be used in an async fn");
+
+    hasReturn = true;
+    if (node->getExpression())
+    {
+        if (coroutine.resultType->isVoidTy())
+            ERROR(node->getLine(), "An async fn returning void cannot return a value");
+        llvm::Value *value = generateExpression(node->getExpression(), coroutine.resultType);
+        if (!value)
+            ERROR(node->getLine(), "Invalid return expression");
+        if (value->getType() != coroutine.resultType)
+            ERROR(node->getLine(), "Type mismatch: returned value does not match the async fn's result type");
+        builder.CreateStore(value, builder.CreateStructGEP(coroutine.promiseType, coroutine.promise, 2, "promise.result"));
+    }
+    else if (!coroutine.resultType->isVoidTy())
+        ERROR(node->getLine(), "Non-void function must return a value");
+
+    builder.CreateBr(coroutine.finalBlock);
+}
+
+llvm::Value *CodeGenerator::handleAwait(const NodeAwait *node, llvm::Type *expectedType)
+{
+    if (!coroutine.handle)
+        ERROR(node->getLine(), "'await' can only be used inside an async fn");
+
+    // Each await hands the current task to the runtime, which resumes it once the
+    // awaited event has happened, then suspends.
+    if (auto builtin = dynamic_cast<const NodeBuiltinCall *>(node->getOperand()))
+    {
+        const std::string &name = builtin->getName();
+        const auto &args = builtin->getArgs();
+        if (name == "readable" || name == "writable")
+        {
+            if (args.size() != 1)
+                ERROR(node->getLine(), "Builtin '@%s' expects a file descriptor", name.c_str());
+            llvm::Value *fd = generateCastExpression(args[0].get(), builder.getInt32Ty());
+            llvm::FunctionCallee awaitFd = module->getOrInsertFunction("tvys_await_fd", builder.getVoidTy(), builder.getPtrTy(),
+                                                                       builder.getInt32Ty(), builder.getInt32Ty());
+            llvm::Value *call = builder.CreateCall(awaitFd, {coroutine.handle, fd, builder.getInt32(name == "readable" ? 1 : 2)});
+            emitSuspend("await.ready");
+            return call;
+        }
+        if (name == "yield")
+        {
+            if (!args.empty())
+                ERROR(node->getLine(), "Builtin '@yield' takes no arguments");
+            llvm::FunctionCallee awaitYield = module->getOrInsertFunction("tvys_await_yield", builder.getVoidTy(), builder.getPtrTy());
+            llvm::Value *call = builder.CreateCall(awaitYield, {coroutine.handle});
+            emitSuspend("await.ready");
+            return call;
+        }
+    }
+
+    // The promise is read at the task's own result type, never the one the context expects.
+    llvm::Type *resultType = getAwaitResultType(node->getOperand());
+    if (!resultType)
+        ERROR(node->getLine(), "'await' expects a call to an async fn, a variable of type task or task<T>, @readable, @writable or @yield");
+    if (resultType->isVoidTy() && expectedType && !expectedType->isVoidTy())
+        ERROR(node->getLine(), "The awaited task returns no value");
+
+    llvm::Value *task = generateExpression(node->getOperand(), builder.getPtrTy());
+    if (!task || !task->getType()->isPointerTy())
+        ERROR(node->getLine(), "'await' expects a task, @readable, @writable or @yield");
+
+    llvm::FunctionCallee awaitTask = module->getOrInsertFunction("tvys_await_task", builder.getVoidTy(), builder.getPtrTy(), builder.getPtrTy());
+    builder.CreateCall(awaitTask, {coroutine.handle, task});
+    emitSuspend("await.ready");
+
+    llvm::Value *result = nullptr;
+    if (!resultType->isVoidTy())
+    {
+        llvm::Value *promise = builder.CreateIntrinsic(llvm::Intrinsic::coro_promise, {}, {task, builder.getInt32(PromiseAlign), builder.getFalse()}, nullptr, "task.promise");
+        llvm::Value *slot = builder.CreateStructGEP(getPromiseType(resultType), promise, 2, "task.result.ptr");
+        result = builder.CreateLoad(resultType, slot, "task.result");
+    }
+    llvm::Value *destroy = builder.CreateIntrinsic(llvm::Intrinsic::coro_destroy, {}, {task});
+    return result ? result : destroy;
+}
+
+llvm::Value *CodeGenerator::handleAsyncBuiltin(const NodeBuiltinCall *call)
+{
+    const std::string &name = call->getName();
+    const auto &args = call->getArgs();
+    const int line = call->getLine();
+    if (name == "spawn" || name == "run")
+        requireHostedRuntime(line, name == "spawn" ? "'@spawn'" : "'@run'");
+
+    if (name == "spawn")
+    {
+        if (args.size() != 1)
+            ERROR(line, "Builtin '@spawn' expects a task");
+        llvm::Value *task = generateExpression(args[0].get(), builder.getPtrTy());
+        if (!task->getType()->isPointerTy())
+            ERROR(line, "Builtin '@spawn' expects a task");
+        llvm::FunctionCallee spawn = module->getOrInsertFunction("tvys_spawn", builder.getVoidTy(), builder.getPtrTy());
+        return builder.CreateCall(spawn, {task});
+    }
+    else if (name == "run")
+    {
+        if (!args.empty())
+            ERROR(line, "Builtin '@run' takes no arguments");
+        llvm::FunctionCallee run = module->getOrInsertFunction("tvys_run", builder.getVoidTy());
+        return builder.CreateCall(run, {});
+    }
+    else if (name == "readable" || name == "writable" || name == "yield")
+        ERROR(line, "Builtin '@%s' can only be used with 'await'", name.c_str());
+
+    return nullptr;
+}
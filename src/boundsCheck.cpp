@@ -0,0 +1,128 @@
+#include "../include/codegen.hpp"
+#include "../include/walk.hpp"
+#include "../include/error.hpp"
+
+// Returns true when index is the loop variable, optionally plus or minus an integer literal.
+static bool matchLoopIndex(const Node *index, const std::string &loopVar, int64_t &offset)
+{
+    if (auto id = dynamic_cast<const NodeIdentifier *>(index))
+    {
+        offset = 0;
+        return id->getName() == loopVar;
+    }
+
+    auto binary = dynamic_cast<const NodeBinaryOp *>(index);
+    if (!binary || (binary->getOp() != Token::Kind::TOKEN_PLUS && binary->getOp() != Token::Kind::TOKEN_MINUS))
+        return false;
+
+    auto id = dynamic_cast<const NodeIdentifier *>(binary->getLeft());
+    auto number = dynamic_cast<const NodeNumber *>(binary->getRight());
+    if (!id || !number)
+    {
+        if (binary->getOp() != Token::Kind::TOKEN_PLUS)
+            return false;
+        id = dynamic_cast<const NodeIdentifier *>(binary->getRight());
+        number = dynamic_cast<const NodeNumber *>(binary->getLeft());
+    }
+    // An offset of INT64_MIN cannot be negated, so such an access keeps its check.
+    if (!id || !number || id->getName() != loopVar || number->getValue() == INT64_MIN)
+        return false;
+
+    offset = binary->getOp() == Token::Kind::TOKEN_PLUS ? number->getValue() : -number->getValue();
+    return true;
+}
+
+std::vector<CodeGenerator::BoundsCheckCandidate> CodeGenerator::elideBoundsChecks(const NodeFor *node, llvm::Value *start, llvm::Value *end)
+{
+    const std::string &loopVar = node->getVarName();
+    std::unordered_set<std::string> rebound;
+    std::vector<BoundsCheckCandidate> candidates;
+    bool innermost = true;
+
+    walkTree(node->getBody(), [&](const Node *child)
+             {
+        if (auto varDecl = dynamic_cast<const NodeVariableDeclaration *>(child))
+            rebound.insert(varDecl->getName());
+        else if (auto assign = dynamic_cast<const NodeAssignment *>(child))
+            rebound.insert(assign->getName());
+        else if (auto loop = dynamic_cast<const NodeFor *>(child))
+        {
+            rebound.insert(loop->getVarName());
+            innermost = false;
+        }
+        else if (dynamic_cast<const NodeWhile *>(child))
+            innermost = false;
+
+        const Node *index = nullptr;
+        std::string arrayName;
+        if (auto access = dynamic_cast<const NodeArrayAccess *>(child))
+        {
+            index = access->getIndex();
+            arrayName = access->getName();
+        }
+        else if (auto assign = dynamic_cast<const NodeArrayAssignment *>(child))
+        {
+            index = assign->getIndex();
+            arrayName = assign->getName();
+        }
+
+        int64_t offset = 0;
+        if (index && matchLoopIndex(index, loopVar, offset))
+            candidates.push_back({index, arrayName, offset}); });
+
+    // A loop variable or array that is redeclared or reassigned inside the body
+    // no longer refers to what the range was checked against.
+    if (rebound.count(loopVar))
+        return {};
+
+    auto *constantStart = llvm::dyn_cast<llvm::ConstantInt>(start);
+    auto *constantEnd = llvm::dyn_cast<llvm::ConstantInt>(end);
+    std::vector<BoundsCheckCandidate> hoisted;
+
+    for (const auto &candidate : candidates)
+    {
+        const SymbolTable::Symbol *sym = symbolTable.lookupVariable(candidate.arrayName);
+        if (!sym || rebound.count(candidate.arrayName) || (!sym->type->isArrayTy() && !isSliceType(sym->type)))
+            continue;
+
+        // The loop reads indices start + offset .. end - 1 + offset, so it stays in
+        // bounds when start + offset >= 0 and end + offset <= length.
+        if (constantStart && constantEnd && sym->type->isArrayTy())
+        {
+            const int64_t first = constantStart->getSExtValue();
+            const int64_t last = constantEnd->getSExtValue();
+            const int64_t length = static_cast<int64_t>(sym->type->getArrayNumElements());
+            int64_t low, high;
+            // If either sum overflows the indices are nowhere near the array, so the check stays.
+            const bool overflows = __builtin_add_overflow(first, candidate.offset, &low) || __builtin_add_overflow(last, candidate.offset, &high);
+            if (first >= last || (!overflows && low >= 0 && high <= length))
+                uncheckedIndices.insert(candidate.index);
+        }
+        else if (innermost)
+            hoisted.push_back(candidate);
+    }
+
+    return hoisted;
+}
+
+llvm::Value *CodeGenerator::emitBoundsGuard(const std::vector<BoundsCheckCandidate> &candidates, llvm::Value *start, llvm::Value *end)
+{
+    llvm::Value *guard = builder.getTrue();
+
+    for (const auto &candidate : candidates)
+    {
+        const SymbolTable::Symbol *sym = symbolTable.lookupVariable(candidate.arrayName);
+        llvm::Value *length = getArrayLength(sym);
+
+        llvm::Value *offset = builder.getInt64(candidate.offset);
+        llvm::Value *lowOk = builder.CreateICmpSGE(start, builder.CreateNeg(offset), "range.low");
+        // length - offset only overflows for a negative offset, where the true bound is beyond any i64 end.
+        llvm::Value *bound = builder.CreateBinaryIntrinsic(llvm::Intrinsic::ssub_with_overflow, length, offset);
+        llvm::Value *highOk = builder.CreateOr(builder.CreateExtractValue(bound, 1),
+                                               builder.CreateICmpSLE(end, builder.CreateExtractValue(bound, 0)), "range.high");
+        guard = builder.CreateAnd(guard, builder.CreateAnd(lowOk, highOk), "range.ok");
+    }
+
+    llvm::Value *empty = builder.CreateICmpSGE(start, end, "range.empty");
+    return builder.CreateOr(empty, guard, "range.guard");
+}
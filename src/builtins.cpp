@@ -0,0 +1,569 @@
+#include "../include/codegen.hpp"
+#include "../include/error.hpp"
+
+static void expectArgCount(const NodeBuiltinCall *call, size_t min, size_t max)
+{
+    const size_t count = call->getArgs().size();
+    if (count < min || count > max)
+    {
+        if (min == max)
+            ERROR(call->getLine(), "Builtin '@%s' expects %zu arguments but got %zu", call->getName().c_str(), min, count);
+        ERROR(call->getLine(), "Builtin '@%s' expects %zu to %zu arguments but got %zu", call->getName().c_str(), min, max, count);
+    }
+}
+
+static llvm::FixedVectorType *requireVectorType(const NodeBuiltinCall *call, llvm::Type *type)
+{
+    auto *vectorType = llvm::dyn_cast_or_null<llvm::FixedVectorType>(type);
+    if (!vectorType)
+        ERROR(call->getLine(), "Builtin '@%s' requires a vector type", call->getName().c_str());
+    return vectorType;
+}
+
+// Memory orderings are written as bare identifiers, e.g. @atomic_load(&x, acquire).
+static llvm::AtomicOrdering parseOrdering(const NodeBuiltinCall *call, const Node *arg)
+{
+    static const std::unordered_map<std::string, llvm::AtomicOrdering> orderings = {
+        {"relaxed", llvm::AtomicOrdering::Monotonic},
+        {"acquire", llvm::AtomicOrdering::Acquire},
+        {"release", llvm::AtomicOrdering::Release},
+        {"acq_rel", llvm::AtomicOrdering::AcquireRelease},
+        {"seq_cst", llvm::AtomicOrdering::SequentiallyConsistent}};
+
+    auto id = dynamic_cast<const NodeIdentifier *>(arg);
+    auto it = id ? orderings.find(id->getName()) : orderings.end();
+    if (it == orderings.end())
+        ERROR(call->getLine(), "Builtin '@%s' expects a memory ordering (relaxed, acquire, release, acq_rel or seq_cst)", call->getName().c_str());
+    return it->second;
+}
+
+llvm::Value *CodeGenerator::handleBuiltinCall(const NodeBuiltinCall *call, llvm::Type *expectedType)
+{
+    if (llvm::Value *result = handleVectorBuiltin(call, expectedType))
+        return result;
+    if (llvm::Value *result = handleSliceBuiltin(call, expectedType))
+        return result;
+    if (llvm::Value *result = handleBitBuiltin(call, expectedType))
+        return result;
+    if (llvm::Value *result = handleAtomicBuiltin(call, expectedType))
+        return result;
+    if (llvm::Value *result = handleAsyncBuiltin(call))
+        return result;
+    if (llvm::Value *result = handleMemoryBuiltin(call))
+        return result;
+
+    ERROR(call->getLine(), "Unknown builtin '@%s'", call->getName().c_str());
+    return nullptr;
+}
+
+llvm::Type *CodeGenerator::getBuiltinType(const NodeBuiltinCall *call, llvm::Type *expectedType)
+{
+    if (call->getTypeArgs().empty())
+        return expectedType;
+
+    llvm::Type *type = getLLVMType(call->getTypeArgs()[0]);
+    if (!type)
+        ERROR(call->getLine(), "Unknown type: %s", call->getTypeArgs()[0].c_str());
+    return type;
+}
+
+llvm::Value *CodeGenerator::toVectorMask(llvm::Value *mask, llvm::FixedVectorType *vectorType, int line)
+{
+    auto *maskType = llvm::dyn_cast<llvm::FixedVectorType>(mask->getType());
+    if (!maskType || !maskType->getElementType()->isIntegerTy() || maskType->getNumElements() != vectorType->getNumElements())
+        ERROR(line, "Mask must be an integer vector with %u lanes", vectorType->getNumElements());
+
+    if (maskType->getElementType()->isIntegerTy(1))
+        return mask;
+    return builder.CreateICmpNE(mask, llvm::Constant::getNullValue(maskType), "mask");
+}
+
+llvm::Value *CodeGenerator::handleVectorBuiltin(const NodeBuiltinCall *call, llvm::Type *expectedType)
+{
+    const std::string &name = call->getName();
+    const auto &args = call->getArgs();
+    const int line = call->getLine();
+    const llvm::DataLayout &dataLayout = module->getDataLayout();
+
+    if (name == "splat")
+    {
+        expectArgCount(call, 1, 1);
+        auto *vectorType = requireVectorType(call, getBuiltinType(call, expectedType));
+        llvm::Type *elementType = vectorType->getElementType();
+        llvm::Value *element = generateCastExpression(args[0].get(), elementType);
+        return builder.CreateVectorSplat(vectorType->getNumElements(), element, "splat");
+    }
+    else if (name == "extract")
+    {
+        expectArgCount(call, 2, 2);
+        llvm::Value *vector = generateExpression(args[0].get(), getBuiltinType(call, nullptr));
+        requireVectorType(call, vector->getType());
+        llvm::Value *lane = generateExpression(args[1].get(), builder.getInt32Ty());
+        return builder.CreateExtractElement(vector, lane, "lane");
+    }
+    else if (name == "insert")
+    {
+        expectArgCount(call, 3, 3);
+        llvm::Value *vector = generateExpression(args[0].get(), getBuiltinType(call, expectedType));
+        llvm::Type *elementType = requireVectorType(call, vector->getType())->getElementType();
+        llvm::Value *lane = generateExpression(args[1].get(), builder.getInt32Ty());
+        llvm::Value *element = generateCastExpression(args[2].get(), elementType);
+        return builder.CreateInsertElement(vector, element, lane, "insert");
+    }
+    else if (name == "shuffle")
+    {
+        if (args.size() < 2)
+            ERROR(line, "Builtin '@shuffle' expects a vector followed by lane indices");
+
+        llvm::Value *first = generateExpression(args[0].get(), getBuiltinType(call, nullptr));
+        auto *vectorType = requireVectorType(call, first->getType());
+
+        size_t maskStart = 1;
+        llvm::Value *second = llvm::PoisonValue::get(vectorType);
+        if (!dynamic_cast<const NodeNumber *>(args[1].get()))
+        {
+            second = generateExpression(args[1].get(), vectorType);
+            if (second->getType() != vectorType)
+                ERROR(line, "Both '@shuffle' operands must have the same vector type");
+            maskStart = 2;
+        }
+
+        const int laneLimit = static_cast<int>(vectorType->getNumElements() * (maskStart == 2 ? 2 : 1));
+        std::vector<int> mask;
+        for (size_t i = maskStart; i < args.size(); i++)
+        {
+            auto number = dynamic_cast<const NodeNumber *>(args[i].get());
+            if (!number)
+                ERROR(line, "Shuffle lane indices must be integer literals");
+            if (number->getValue() < 0 || number->getValue() >= laneLimit)
+                ERROR(line, "Shuffle lane index %lld out of range", static_cast<long long>(number->getValue()));
+            mask.push_back(number->getValue());
+        }
+        if (mask.empty())
+            ERROR(line, "Builtin '@shuffle' expects at least one lane index");
+
+        return builder.CreateShuffleVector(first, second, mask, "shuffle");
+    }
+    else if (name.rfind("reduce_", 0) == 0)
+    {
+        expectArgCount(call, 1, 1);
+        llvm::Value *vector = generateExpression(args[0].get(), getBuiltinType(call, nullptr));
+        llvm::Type *elementType = requireVectorType(call, vector->getType())->getElementType();
+        const std::string op = name.substr(7);
+
+        if (elementType->isFloatingPointTy())
+        {
+            llvm::Value *result = nullptr;
+            if (op == "add")
+                result = builder.CreateFAddReduce(llvm::ConstantFP::getNegativeZero(elementType), vector);
+            else if (op == "mul")
+                result = builder.CreateFMulReduce(llvm::ConstantFP::get(elementType, 1.0), vector);
+            else if (op == "min")
+                result = builder.CreateFPMinReduce(vector);
+            else if (op == "max")
+                result = builder.CreateFPMaxReduce(vector);
+            else
+                ERROR(line, "Builtin '@%s' is not defined for floating-point vectors", name.c_str());
+
+            // Horizontal reductions are expected to be tree-shaped, not a strict lane-by-lane chain.
+            llvm::FastMathFlags flags;
+            flags.setAllowReassoc();
+            llvm::cast<llvm::Instruction>(result)->setFastMathFlags(flags);
+            return result;
+        }
+
+        if (op == "add")
+            return builder.CreateAddReduce(vector);
+        else if (op == "mul")
+            return builder.CreateMulReduce(vector);
+        else if (op == "and")
+            return builder.CreateAndReduce(vector);
+        else if (op == "or")
+            return builder.CreateOrReduce(vector);
+        else if (op == "xor")
+            return builder.CreateXorReduce(vector);
+        else if (op == "min")
+            return builder.CreateIntMinReduce(vector, true);
+        else if (op == "max")
+            return builder.CreateIntMaxReduce(vector, true);
+        return nullptr;
+    }
+    else if (name == "load")
+    {
+        expectArgCount(call, 1, 1);
+        auto *vectorType = requireVectorType(call, getBuiltinType(call, expectedType));
+        llvm::Value *ptr = generateExpression(args[0].get(), nullptr);
+        llvm::Align align = dataLayout.getABITypeAlign(vectorType->getElementType());
+        return builder.CreateAlignedLoad(vectorType, ptr, align, "vload");
+    }
+    else if (name == "store")
+    {
+        expectArgCount(call, 2, 2);
+        llvm::Value *vector = generateExpression(args[0].get(), getBuiltinType(call, nullptr));
+        auto *vectorType = requireVectorType(call, vector->getType());
+        llvm::Value *ptr = generateExpression(args[1].get(), nullptr);
+        llvm::Align align = dataLayout.getABITypeAlign(vectorType->getElementType());
+        return builder.CreateAlignedStore(vector, ptr, align);
+    }
+    else if (name == "masked_load")
+    {
+        expectArgCount(call, 2, 3);
+        auto *vectorType = requireVectorType(call, getBuiltinType(call, expectedType));
+        llvm::Value *ptr = generateExpression(args[0].get(), nullptr);
+        llvm::Value *mask = toVectorMask(generateExpression(args[1].get(), nullptr), vectorType, line);
+        llvm::Value *passThru = args.size() > 2 ? generateCastExpression(args[2].get(), vectorType)
+                                                : llvm::Constant::getNullValue(vectorType);
+        llvm::Align align = dataLayout.getABITypeAlign(vectorType->getElementType());
+        return builder.CreateMaskedLoad(vectorType, ptr, align, mask, passThru, "mload");
+    }
+    else if (name == "masked_store")
+    {
+        expectArgCount(call, 3, 3);
+        llvm::Value *vector = generateExpression(args[0].get(), getBuiltinType(call, nullptr));
+        auto *vectorType = requireVectorType(call, vector->getType());
+        llvm::Value *ptr = generateExpression(args[1].get(), nullptr);
+        llvm::Value *mask = toVectorMask(generateExpression(args[2].get(), nullptr), vectorType, line);
+        llvm::Align align = dataLayout.getABITypeAlign(vectorType->getElementType());
+        return builder.CreateMaskedStore(vector, ptr, align, mask);
+    }
+    else if (name == "gather")
+    {
+        expectArgCount(call, 2, 4);
+        auto *vectorType = requireVectorType(call, getBuiltinType(call, expectedType));
+        llvm::Value *base = generateExpression(args[0].get(), nullptr);
+        llvm::Value *indices = generateExpression(args[1].get(), nullptr);
+        auto *indexType = requireVectorType(call, indices->getType());
+        if (!indexType->getElementType()->isIntegerTy() || indexType->getNumElements() != vectorType->getNumElements())
+            ERROR(line, "Builtin '@gather' needs an integer index vector with %u lanes", vectorType->getNumElements());
+
+        llvm::Value *ptrs = builder.CreateGEP(vectorType->getElementType(), base, indices, "gatherptrs");
+        llvm::Value *mask = args.size() > 2 ? toVectorMask(generateExpression(args[2].get(), nullptr), vectorType, line) : nullptr;
+        llvm::Value *passThru = args.size() > 3 ? generateCastExpression(args[3].get(), vectorType) : nullptr;
+        llvm::Align align = dataLayout.getABITypeAlign(vectorType->getElementType());
+        return builder.CreateMaskedGather(vectorType, ptrs, align, mask, passThru, "gather");
+    }
+    else if (name == "scatter")
+    {
+        expectArgCount(call, 3, 4);
+        llvm::Value *vector = generateExpression(args[0].get(), getBuiltinType(call, nullptr));
+        auto *vectorType = requireVectorType(call, vector->getType());
+        llvm::Value *base = generateExpression(args[1].get(), nullptr);
+        llvm::Value *indices = generateExpression(args[2].get(), nullptr);
+        auto *indexType = requireVectorType(call, indices->getType());
+        if (!indexType->getElementType()->isIntegerTy() || indexType->getNumElements() != vectorType->getNumElements())
+            ERROR(line, "Builtin '@scatter' needs an integer index vector with %u lanes", vectorType->getNumElements());
+
+        llvm::Value *ptrs = builder.CreateGEP(vectorType->getElementType(), base, indices, "scatterptrs");
+        llvm::Value *mask = args.size() > 3 ? toVectorMask(generateExpression(args[3].get(), nullptr), vectorType, line) : nullptr;
+        llvm::Align align = dataLayout.getABITypeAlign(vectorType->getElementType());
+        return builder.CreateMaskedScatter(vector, ptrs, align, mask);
+    }
+
+    return nullptr;
+}
+
+llvm::Value *CodeGenerator::handleSliceBuiltin(const NodeBuiltinCall *call, llvm::Type *expectedType)
+{
+    const std::string &name = call->getName();
+    const auto &args = call->getArgs();
+    const int line = call->getLine();
+
+    if (name == "slice")
+    {
+        expectArgCount(call, 2, 2);
+        llvm::Type *sliceType = getBuiltinType(call, expectedType);
+        if (!isSliceType(sliceType))
+            ERROR(line, "Builtin '@slice' requires a slice type such as '[]i32'");
+
+        llvm::Value *data = generateExpression(args[0].get(), nullptr);
+        if (!data->getType()->isPointerTy())
+            ERROR(line, "First argument of '@slice' must be a pointer");
+        llvm::Value *length = generateCastExpression(args[1].get(), builder.getInt64Ty());
+        return makeSlice(sliceType, data, length);
+    }
+    else if (name == "len" || name == "ptr")
+    {
+        expectArgCount(call, 1, 1);
+        auto id = dynamic_cast<const NodeIdentifier *>(args[0].get());
+        const SymbolTable::Symbol *sym = id ? symbolTable.lookupVariable(id->getName()) : nullptr;
+
+        if (sym && sym->type->isArrayTy())
+        {
+            if (name == "len")
+                return builder.getInt64(sym->type->getArrayNumElements());
+            return builder.CreateInBoundsGEP(sym->type, sym->value, {builder.getInt64(0), builder.getInt64(0)}, "array.ptr");
+        }
+
+        llvm::Value *slice = generateExpression(args[0].get(), nullptr);
+        if (!isSliceType(slice->getType()))
+            ERROR(line, "Builtin '@%s' requires an array or slice", name.c_str());
+        return builder.CreateExtractValue(slice, name == "len" ? 1 : 0, name == "len" ? "slice.len" : "slice.ptr");
+    }
+
+    return nullptr;
+}
+
+bool CodeGenerator::isBitBuiltin(const std::string &name)
+{
+    static const std::unordered_set<std::string> names = {
+        "popcount", "clz", "ctz", "bswap", "rotl", "rotr", "fshl", "fshr", "expect"};
+    return names.count(name) != 0;
+}
+
+llvm::Value *CodeGenerator::handleBitBuiltin(const NodeBuiltinCall *call, llvm::Type *expectedType)
+{
+    const std::string &name = call->getName();
+    const auto &args = call->getArgs();
+    const int line = call->getLine();
+
+    // The operand width comes from <T>, then from the first argument, then from the context,
+    // so every intrinsic is instantiated at the width of the value it is applied to.
+    auto operandType = [&](bool allowBool)
+    {
+        llvm::Type *type = call->getTypeArgs().empty() ? inferExpressionType(args[0].get()) : getBuiltinType(call, nullptr);
+        if (!type)
+            type = expectedType ? expectedType : builder.getInt32Ty();
+        if (!type->isIntOrIntVectorTy() || (!allowBool && type->isIntOrIntVectorTy(1)))
+            ERROR(line, "Builtin '@%s' requires an integer operand", name.c_str());
+        return type;
+    };
+    auto operand = [&](size_t index, llvm::Type *type)
+    {
+        return generateCastExpression(args[index].get(), type);
+    };
+
+    if (name == "popcount" || name == "clz" || name == "ctz")
+    {
+        expectArgCount(call, 1, 1);
+        llvm::Type *type = operandType(false);
+        llvm::Value *value = operand(0, type);
+        if (name == "popcount")
+            return builder.CreateUnaryIntrinsic(llvm::Intrinsic::ctpop, value, nullptr, "popcount");
+
+        // Zero is a valid input and yields the bit width, matching the portable definition.
+        const llvm::Intrinsic::ID id = name == "clz" ? llvm::Intrinsic::ctlz : llvm::Intrinsic::cttz;
+        return builder.CreateIntrinsic(id, {type}, {value, builder.getFalse()}, nullptr, name);
+    }
+    else if (name == "bswap")
+    {
+        expectArgCount(call, 1, 1);
+        llvm::Type *type = operandType(false);
+        if (type->getScalarSizeInBits() % 16 != 0)
+            ERROR(line, "Builtin '@bswap' requires an integer width that is a multiple of 16");
+        return builder.CreateUnaryIntrinsic(llvm::Intrinsic::bswap, operand(0, type), nullptr, "bswap");
+    }
+    else if (name == "rotl" || name == "rotr")
+    {
+        // A funnel shift of a value with itself is a rotate, which backends match to a single instruction.
+        expectArgCount(call, 2, 2);
+        llvm::Type *type = operandType(false);
+        llvm::Value *value = operand(0, type);
+        llvm::Value *amount = operand(1, type);
+        const llvm::Intrinsic::ID id = name == "rotl" ? llvm::Intrinsic::fshl : llvm::Intrinsic::fshr;
+        return builder.CreateIntrinsic(id, {type}, {value, value, amount}, nullptr, name);
+    }
+    else if (name == "fshl" || name == "fshr")
+    {
+        expectArgCount(call, 3, 3);
+        llvm::Type *type = operandType(false);
+        llvm::Value *high = operand(0, type);
+        llvm::Value *low = operand(1, type);
+        llvm::Value *amount = operand(2, type);
+        const llvm::Intrinsic::ID id = name == "fshl" ? llvm::Intrinsic::fshl : llvm::Intrinsic::fshr;
+        return builder.CreateIntrinsic(id, {type}, {high, low, amount}, nullptr, name);
+    }
+    else if (name == "expect")
+    {
+        expectArgCount(call, 2, 2);
+        llvm::Type *type = operandType(true);
+        llvm::Value *value = operand(0, type);
+        llvm::Value *expected = operand(1, type);
+        if (!llvm::isa<llvm::Constant>(expected))
+            ERROR(line, "Second argument of '@expect' must be a constant");
+        return builder.CreateIntrinsic(llvm::Intrinsic::expect, {type}, {value, expected}, nullptr, "expect");
+    }
+    else if (name == "prefetch")
+    {
+        // @prefetch(ptr, rw, locality): rw is 0 for reads and 1 for writes, locality runs
+        // from 0 (no temporal locality) to 3 (keep in all cache levels).
+        expectArgCount(call, 1, 3);
+        llvm::Value *address = generateExpression(args[0].get(), nullptr);
+        if (!address->getType()->isPointerTy())
+            ERROR(line, "First argument of '@prefetch' must be a pointer");
+
+        int64_t hints[2] = {0, 3};
+        for (size_t i = 1; i < args.size(); i++)
+        {
+            auto number = dynamic_cast<const NodeNumber *>(args[i].get());
+            if (!number)
+                ERROR(line, "Prefetch hints must be integer literals");
+            hints[i - 1] = number->getValue();
+        }
+        if (hints[0] < 0 || hints[0] > 1)
+            ERROR(line, "Prefetch access must be 0 (read) or 1 (write)");
+        if (hints[1] < 0 || hints[1] > 3)
+            ERROR(line, "Prefetch locality must be between 0 and 3");
+
+        return builder.CreateIntrinsic(llvm::Intrinsic::prefetch, {address->getType()},
+                                       {address, builder.getInt32(hints[0]), builder.getInt32(hints[1]), builder.getInt32(1)});
+    }
+    else if (name == "assume")
+    {
+        expectArgCount(call, 1, 1);
+        return builder.CreateAssumption(generateCondition(args[0].get()));
+    }
+
+    return nullptr;
+}
+
+bool CodeGenerator::isAtomicBuiltin(const std::string &name)
+{
+    return name.rfind("atomic_", 0) == 0;
+}
+
+llvm::Type *CodeGenerator::inferAtomicType(const NodeBuiltinCall *call)
+{
+    if (!call->getTypeArgs().empty())
+        return getBuiltinType(call, nullptr);
+
+    const auto &args = call->getArgs();
+    if (args.empty())
+        return nullptr;
+
+    // The pointee is known for &variable and for pointers declared as T*.
+    if (auto unary = dynamic_cast<const NodeUnaryOp *>(args[0].get()); unary && unary->getOp() == Token::Kind::TOKEN_AMPERSAND)
+    {
+        if (auto id = dynamic_cast<const NodeIdentifier *>(unary->getOperand()))
+        {
+            const SymbolTable::Symbol *sym = symbolTable.lookupVariable(id->getName());
+            return sym ? sym->type : nullptr;
+        }
+        if (auto access = dynamic_cast<const NodeArrayAccess *>(unary->getOperand()))
+            return inferExpressionType(access);
+    }
+    if (auto id = dynamic_cast<const NodeIdentifier *>(args[0].get()))
+    {
+        const SymbolTable::Symbol *sym = symbolTable.lookupVariable(id->getName());
+        if (sym && !sym->baseType.empty() && sym->baseType.back() == '*')
+            return getLLVMType(sym->baseType.substr(0, sym->baseType.size() - 1));
+    }
+
+    // Otherwise from the value operands; @atomic_load has none, its trailing argument
+    // is an ordering.
+    if (call->getName() == "atomic_load")
+        return nullptr;
+    const size_t operands = call->getName() == "atomic_cas" || call->getName() == "atomic_cas_weak" ? 3 : 2;
+    for (size_t i = 1; i < operands && i < args.size(); i++)
+    {
+        if (llvm::Type *type = inferExpressionType(args[i].get()))
+            return type;
+    }
+    return nullptr;
+}
+
+llvm::Value *CodeGenerator::handleAtomicBuiltin(const NodeBuiltinCall *call, llvm::Type *expectedType)
+{
+    const std::string &name = call->getName();
+    const auto &args = call->getArgs();
+    const int line = call->getLine();
+
+    if (name == "fence")
+    {
+        expectArgCount(call, 0, 1);
+        const llvm::AtomicOrdering ordering = args.empty() ? llvm::AtomicOrdering::SequentiallyConsistent : parseOrdering(call, args[0].get());
+        if (ordering == llvm::AtomicOrdering::Monotonic)
+            ERROR(line, "A fence cannot be relaxed");
+        return builder.CreateFence(ordering);
+    }
+    if (!isAtomicBuiltin(name))
+        return nullptr;
+
+    const std::string op = name.substr(7);
+    const bool isCas = op == "cas" || op == "cas_weak";
+    const size_t operands = op == "load" ? 1 : isCas ? 3 : 2;
+    const size_t orderingCount = isCas ? 2 : 1;
+    expectArgCount(call, operands, operands + orderingCount);
+
+    llvm::Type *type = inferAtomicType(call);
+    if (!type)
+        type = expectedType ? expectedType : builder.getInt32Ty();
+    if (!type->isIntegerTy() && !type->isFloatingPointTy() && !type->isPointerTy())
+        ERROR(line, "Builtin '@%s' requires an integer, floating-point or pointer operand", name.c_str());
+    // Atomic instructions only exist for whole, power-of-two byte sizes.
+    if (type->isIntegerTy())
+    {
+        const unsigned bits = type->getIntegerBitWidth();
+        if (bits < 8 || !llvm::isPowerOf2_32(bits))
+            ERROR(line, "Builtin '@%s' requires an integer of 8, 16, 32 or 64 bits, not i%u", name.c_str(), bits);
+    }
+
+    llvm::Value *address = generateExpression(args[0].get(), nullptr);
+    if (!address->getType()->isPointerTy())
+        ERROR(line, "First argument of '@%s' must be a pointer", name.c_str());
+    auto operand = [&](size_t index)
+    {
+        return generateCastExpression(args[index].get(), type);
+    };
+
+    // Orderings default to seq_cst; a compare-exchange failure ordering defaults to the
+    // strongest one that is valid for a pure load.
+    llvm::AtomicOrdering ordering = args.size() > operands ? parseOrdering(call, args[operands].get()) : llvm::AtomicOrdering::SequentiallyConsistent;
+
+    // Atomic accesses must be naturally aligned regardless of the type's ABI alignment.
+    const llvm::Align align(module->getDataLayout().getTypeStoreSize(type));
+
+    if (op == "load")
+    {
+        if (ordering == llvm::AtomicOrdering::Release || ordering == llvm::AtomicOrdering::AcquireRelease)
+            ERROR(line, "An atomic load cannot have release semantics");
+        llvm::LoadInst *load = builder.CreateAlignedLoad(type, address, align, "atomic.load");
+        load->setAtomic(ordering);
+        return load;
+    }
+    if (op == "store")
+    {
+        if (ordering == llvm::AtomicOrdering::Acquire || ordering == llvm::AtomicOrdering::AcquireRelease)
+            ERROR(line, "An atomic store cannot have acquire semantics");
+        llvm::StoreInst *store = builder.CreateAlignedStore(operand(1), address, align);
+        store->setAtomic(ordering);
+        return store;
+    }
+    if (isCas)
+    {
+        if (type->isFloatingPointTy())
+            ERROR(line, "Builtin '@%s' requires an integer or pointer operand", name.c_str());
+
+        llvm::AtomicOrdering failure = llvm::AtomicCmpXchgInst::getStrongestFailureOrdering(ordering);
+        if (args.size() > operands + 1)
+            failure = parseOrdering(call, args[operands + 1].get());
+        if (failure == llvm::AtomicOrdering::Release || failure == llvm::AtomicOrdering::AcquireRelease)
+            ERROR(line, "A compare-exchange failure ordering cannot have release semantics");
+
+        // Returns the value that was in memory; the exchange happened when it equals the expected value.
+        llvm::AtomicCmpXchgInst *cas = builder.CreateAtomicCmpXchg(address, operand(1), operand(2), align, ordering, failure);
+        cas->setWeak(op == "cas_weak");
+        return builder.CreateExtractValue(cas, 0, "cas.old");
+    }
+
+    static const std::unordered_map<std::string, llvm::AtomicRMWInst::BinOp> intOps = {
+        {"xchg", llvm::AtomicRMWInst::Xchg},
+        {"fetch_add", llvm::AtomicRMWInst::Add},
+        {"fetch_sub", llvm::AtomicRMWInst::Sub},
+        {"fetch_and", llvm::AtomicRMWInst::And},
+        {"fetch_or", llvm::AtomicRMWInst::Or},
+        {"fetch_xor", llvm::AtomicRMWInst::Xor},
+        {"fetch_min", llvm::AtomicRMWInst::Min},
+        {"fetch_max", llvm::AtomicRMWInst::Max}};
+    static const std::unordered_map<std::string, llvm::AtomicRMWInst::BinOp> floatOps = {
+        {"xchg", llvm::AtomicRMWInst::Xchg},
+        {"fetch_add", llvm::AtomicRMWInst::FAdd},
+        {"fetch_sub", llvm::AtomicRMWInst::FSub}};
+
+    const auto &ops = type->isFloatingPointTy() ? floatOps : intOps;
+    auto it = ops.find(op);
+    if (it == ops.end() || (type->isPointerTy() && op != "xchg"))
+        ERROR(line, "Unknown atomic builtin '@%s' for this operand type", name.c_str());
+
+    // Returns the value that was in memory before the operation.
+    return builder.CreateAtomicRMW(it->second, address, operand(1), align, ordering);
+}
\ No newline at end of file
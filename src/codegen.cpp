@@ -1,11 +1,21 @@
 #include "../include/codegen.hpp"
 #include "../include/error.hpp"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/Analysis/ValueTracking.h"
 #include <cstdlib>
 #include <cerrno>
+#include <functional>
+#include <tuple>
 
-void SymbolTable::addVariable(const std::string &name, llvm::Value *value, llvm::Type *type, const std::string &baseType)
+SymbolTable::Symbol &SymbolTable::addVariable(const std::string &name, llvm::Value *value, llvm::Type *type, const std::string &baseType)
 {
-    scopes.back()[name] = {value, type, baseType};
+    return scopes.back()[name] = {value, type, baseType};
+}
+
+void SymbolTable::addValue(const std::string &name, llvm::Value *value, llvm::Type *type, const std::string &baseType)
+{
+    scopes.back()[name] = {value, type, baseType, true};
 }
 
 const SymbolTable::Symbol *SymbolTable::lookupVariable(const std::string &name) const
@@ -34,6 +44,17 @@ llvm::Type *CodeGenerator::getLLVMType(const std::string &typeName)
     if (typeName.empty())
         ERROR(0, "Empty type name provided");
 
+    if (typeName.rfind("restrict ", 0) == 0)
+        return getLLVMType(typeName.substr(9));
+
+    if (typeName.rfind("[]", 0) == 0)
+    {
+        llvm::Type *elementType = getLLVMType(typeName.substr(2));
+        if (!elementType || elementType->isVoidTy())
+            ERROR(0, "Invalid slice element type: %s", typeName.c_str());
+        return llvm::StructType::get(context, {llvm::PointerType::getUnqual(elementType), builder.getInt64Ty()});
+    }
+
     if (typeName.back() == '*')
     {
         std::string baseTypeName = typeName.substr(0, typeName.size() - 1);
@@ -72,8 +93,26 @@ llvm::Type *CodeGenerator::getBaseLLVMType(const std::string &baseTypeStr)
         return llvm::Type::getInt32Ty(context);
     else if (baseTypeStr == "i64")
         return llvm::Type::getInt64Ty(context);
+    else if (baseTypeStr == "f32")
+        return llvm::Type::getFloatTy(context);
+    else if (baseTypeStr == "f64")
+        return llvm::Type::getDoubleTy(context);
+    else if (baseTypeStr == "bool")
+        return llvm::Type::getInt1Ty(context);
     else if (baseTypeStr == "void")
         return llvm::Type::getVoidTy(context);
+    else if (baseTypeStr == "task" || baseTypeStr.rfind("task<", 0) == 0 || baseTypeStr == "arena" || baseTypeStr == "pool")
+        return llvm::PointerType::getUnqual(context);
+
+    size_t lanePos = baseTypeStr.find('x');
+    if (lanePos != std::string::npos)
+    {
+        llvm::Type *elementType = getBaseLLVMType(baseTypeStr.substr(0, lanePos));
+        unsigned long lanes = strtoul(baseTypeStr.c_str() + lanePos + 1, nullptr, 10);
+        if (!elementType || elementType->isVoidTy() || lanes == 0)
+            return nullptr;
+        return llvm::FixedVectorType::get(elementType, lanes);
+    }
     return nullptr;
 }
 
@@ -128,17 +167,27 @@ llvm::Value *CodeGenerator::generateExpression(const Node *node, llvm::Type *exp
     else if (auto arrayAssign = dynamic_cast<const NodeArrayAssignment *>(node))
         return handleArrayAssignment(arrayAssign);
     else if (auto id = dynamic_cast<const NodeIdentifier *>(node))
-        return handleIdentifier(id);
+        return handleIdentifier(id, expectedType);
     else if (auto number = dynamic_cast<const NodeNumber *>(node))
     {
         if (!expectedType)
             ERROR(node->getLine(), "Expected type for number literal.");
         return handleNumber(number, expectedType);
     }
+    else if (auto number = dynamic_cast<const NodeFloat *>(node))
+        return handleFloat(number, expectedType);
+    else if (auto boolean = dynamic_cast<const NodeBool *>(node))
+        return castValue(builder.getInt1(boolean->getValue()), expectedType);
     else if (auto binary = dynamic_cast<const NodeBinaryOp *>(node))
         return handleBinaryOp(binary, expectedType);
     else if (auto call = dynamic_cast<const NodeFunctionCall *>(node))
         return handleFunctionCall(call, expectedType);
+    else if (auto builtin = dynamic_cast<const NodeBuiltinCall *>(node))
+        return handleBuiltinCall(builtin, expectedType);
+    else if (auto await = dynamic_cast<const NodeAwait *>(node))
+        return handleAwait(await, expectedType);
+    else if (auto literal = dynamic_cast<const NodeArrayLiteral *>(node))
+        return handleArrayLiteral(literal, expectedType);
     return nullptr;
 }
 
@@ -151,7 +200,9 @@ llvm::Value *CodeGenerator::handleUnaryOp(const NodeUnaryOp *node, llvm::Type *e
             ERROR(node->getLine(), "Invalid pointer expression for dereference.");
         if (!expectedType)
             ERROR(node->getLine(), "Expected type must be provided for dereference.");
-        return builder.CreateLoad(expectedType, ptr, "deref");
+        llvm::Value *load = builder.CreateLoad(expectedType, ptr, "deref");
+        tagRestrictAccess(load, node->getOperand());
+        return load;
     }
     else if (node->getOp() == Token::Kind::TOKEN_AMPERSAND)
     {
@@ -161,6 +212,8 @@ llvm::Value *CodeGenerator::handleUnaryOp(const NodeUnaryOp *node, llvm::Type *e
             const SymbolTable::Symbol *sym = symbolTable.lookupVariable(id->getName());
             if (!sym)
                 ERROR(node->getLine(), "Undefined variable: %s", id->getName().c_str());
+            if (sym->isValue)
+                ERROR(node->getLine(), "Cannot take the address of loop variable '%s'", id->getName().c_str());
             return sym->value;
         }
         else if (auto arrayAccess = dynamic_cast<const NodeArrayAccess *>(operand))
@@ -168,28 +221,43 @@ llvm::Value *CodeGenerator::handleUnaryOp(const NodeUnaryOp *node, llvm::Type *e
             const SymbolTable::Symbol *sym = symbolTable.lookupVariable(arrayAccess->getName());
             if (!sym)
                 ERROR(arrayAccess->getLine(), "Undefined array: %s", arrayAccess->getName().c_str());
+            if (sym->type->isVectorTy())
+                ERROR(arrayAccess->getLine(), "Cannot take the address of a vector lane.");
 
-            llvm::Value *index = generateExpression(arrayAccess->getIndex(), builder.getInt32Ty());
-            std::vector<llvm::Value *> indices = {builder.getInt32(0), index};
-            llvm::Value *elementPtr = builder.CreateGEP(sym->type, sym->value, indices, "arrayptr");
-            return elementPtr;
+            llvm::Type *elementType = nullptr;
+            return getElementPointer(sym, arrayAccess->getIndex(), elementType, arrayAccess->getLine());
         }
         else
             ERROR(node->getLine(), "The '&' operator can only be applied to an identifier or an array element.");
     }
+    else if (node->getOp() == Token::Kind::TOKEN_BANG)
+        return widenComparison(builder.CreateNot(generateCondition(node->getOperand()), "nottmp"), expectedType);
     return nullptr;
 }
 
 llvm::Value *CodeGenerator::handleCast(const NodeCast *cast)
 {
-    llvm::Value *exprVal = generateExpression(cast->getExpression(), nullptr);
     llvm::Type *targetType = getLLVMType(cast->getTargetType());
+    llvm::Type *sourceType = inferExpressionType(cast->getExpression());
+    llvm::Value *exprVal = generateExpression(cast->getExpression(), sourceType ? sourceType : targetType);
     return castValue(exprVal, targetType);
 }
 
 llvm::Value *CodeGenerator::handleString(const NodeString *node)
 {
-    return builder.CreateGlobalStringPtr(node->getValue());
+    return getStringConstant(node->getValue());
+}
+
+llvm::Constant *CodeGenerator::getStringConstant(const std::string &value)
+{
+    // Identical literals share one unnamed_addr constant, which the linker may merge further.
+    auto it = stringPool.find(value);
+    if (it != stringPool.end())
+        return it->second;
+
+    llvm::Constant *str = builder.CreateGlobalString(value, ".str", 0, module.get());
+    stringPool[value] = str;
+    return str;
 }
 
 llvm::Value *CodeGenerator::handleAssignment(const NodeAssignment *assign, llvm::Type *expectedType)
@@ -197,10 +265,22 @@ llvm::Value *CodeGenerator::handleAssignment(const NodeAssignment *assign, llvm:
     const SymbolTable::Symbol *sym = symbolTable.lookupVariable(assign->getName());
     if (!sym)
         ERROR(assign->getLine(), "Undefined variable: %s", assign->getName().c_str());
+    if (sym->isValue)
+        ERROR(assign->getLine(), "Cannot assign to loop variable '%s'", assign->getName().c_str());
+    if (sym->isConst)
+        ERROR(assign->getLine(), "Cannot assign to constant '%s'", assign->getName().c_str());
+    checkTaskValue(sym->baseType, assign->getValue(), assign->getLine());
     llvm::Value *value = generateExpression(assign->getValue(), sym->type);
     if (!value)
         return nullptr;
-    builder.CreateStore(value, sym->value);
+    value = castValue(value, sym->type);
+    if (sym->ssaSlot >= 0)
+    {
+        writeVariable(sym->ssaSlot, builder.GetInsertBlock(), value);
+        emitDebugValue(ssaVariables[sym->ssaSlot].debugVariable, value);
+    }
+    else
+        builder.CreateStore(value, sym->value);
     return value;
 }
 
@@ -217,7 +297,7 @@ llvm::Value *CodeGenerator::handlePointerAssignment(const NodePointerAssignment
             llvm::Value *value = generateExpression(ptrAssign->getValue(), expectedType);
             if (!value)
                 return nullptr;
-            builder.CreateStore(value, ptr);
+            tagRestrictAccess(builder.CreateStore(castValue(value, expectedType), ptr), sym);
             return value;
         }
     }
@@ -231,25 +311,18 @@ llvm::Value *CodeGenerator::handleArrayAccess(const NodeArrayAccess *arrayAccess
     if (!sym)
         ERROR(arrayAccess->getLine(), "Undefined variable: %s", arrayAccess->getName().c_str());
 
-    llvm::Value *index = generateExpression(arrayAccess->getIndex(), builder.getInt32Ty());
-    std::vector<llvm::Value *> indices;
-
-    if (sym->type->isPointerTy())
-    {
-        std::string pointeeTypeStr = sym->baseType.substr(0, sym->baseType.size() - 1);
-        llvm::Type *pointeeType = getLLVMType(pointeeTypeStr);
-
-        llvm::Value *loadedPtr = builder.CreateLoad(sym->type, sym->value, "loadptr");
-        indices.push_back(index);
-        llvm::Value *elementPtr = builder.CreateGEP(pointeeType, loadedPtr, indices, "ptridx");
-        return builder.CreateLoad(pointeeType, elementPtr, "load");
-    }
-    else
+    if (sym->type->isVectorTy())
     {
-        indices = {builder.getInt32(0), index};
-        llvm::Value *elementPtr = builder.CreateGEP(sym->type, sym->value, indices, "arrayidx");
-        return builder.CreateLoad(sym->type->getArrayElementType(), elementPtr, "arrayval");
+        llvm::Value *vector = loadVariable(sym, arrayAccess->getName() + ".val");
+        llvm::Value *lane = generateExpression(arrayAccess->getIndex(), builder.getInt32Ty());
+        return builder.CreateExtractElement(vector, lane, "lane");
     }
+
+    llvm::Type *elementType = nullptr;
+    llvm::Value *elementPtr = getElementPointer(sym, arrayAccess->getIndex(), elementType, arrayAccess->getLine());
+    llvm::Value *load = builder.CreateLoad(elementType, elementPtr, "arrayval");
+    tagRestrictAccess(load, sym);
+    return load;
 }
 
 llvm::Value *CodeGenerator::handleArrayAssignment(const NodeArrayAssignment *arrayAssign)
@@ -257,56 +330,200 @@ llvm::Value *CodeGenerator::handleArrayAssignment(const NodeArrayAssignment *arr
     const SymbolTable::Symbol *sym = symbolTable.lookupVariable(arrayAssign->getName());
     if (!sym)
         ERROR(arrayAssign->getLine(), "Undefined variable: %s", arrayAssign->getName().c_str());
+    if (sym->isConst)
+        ERROR(arrayAssign->getLine(), "Cannot assign to constant '%s'", arrayAssign->getName().c_str());
+
+    if (auto *vectorType = llvm::dyn_cast<llvm::FixedVectorType>(sym->type))
+    {
+        llvm::Value *lane = generateExpression(arrayAssign->getIndex(), builder.getInt32Ty());
+        llvm::Value *value = generateCastExpression(arrayAssign->getValue(), vectorType->getElementType());
+        llvm::Value *vector = builder.CreateLoad(sym->type, sym->value, arrayAssign->getName() + ".val");
+        builder.CreateStore(builder.CreateInsertElement(vector, value, lane, "insert"), sym->value);
+        return value;
+    }
 
-    llvm::Value *index = generateExpression(arrayAssign->getIndex(), builder.getInt32Ty());
-    std::vector<llvm::Value *> indices;
     llvm::Type *elementType = nullptr;
-    llvm::Value *elementPtr = nullptr;
+    llvm::Value *elementPtr = getElementPointer(sym, arrayAssign->getIndex(), elementType, arrayAssign->getLine());
+
+    llvm::Value *value = generateExpression(arrayAssign->getValue(), elementType);
+    value = castValue(value, elementType);
+    tagRestrictAccess(builder.CreateStore(value, elementPtr), sym);
+    return value;
+}
+
+llvm::Value *CodeGenerator::getElementPointer(const SymbolTable::Symbol *sym, const Node *indexNode, llvm::Type *&elementType, int line)
+{
+    llvm::Value *index = generateCastExpression(indexNode, builder.getInt64Ty());
+    const bool checked = boundsChecks && !uncheckedIndices.count(indexNode);
+    auto guarded = guardedIndices.find(indexNode);
+    llvm::Value *guard = guarded != guardedIndices.end() ? guarded->second : nullptr;
+
+    if (isSliceType(sym->type))
+    {
+        elementType = getLLVMType(sym->baseType.substr(sym->baseType.find("[]") + 2));
+        llvm::Value *slice = loadVariable(sym, "slice");
+        llvm::Value *data = builder.CreateExtractValue(slice, 0, "slice.ptr");
+        if (checked)
+            emitBoundsCheck(index, builder.CreateExtractValue(slice, 1, "slice.len"), guard);
+        return builder.CreateGEP(elementType, data, index, "sliceidx");
+    }
 
     if (sym->type->isPointerTy())
     {
         std::string pointeeTypeStr = sym->baseType.substr(0, sym->baseType.size() - 1);
-        llvm::Type *pointeeType = getLLVMType(pointeeTypeStr);
+        elementType = getLLVMType(pointeeTypeStr);
 
-        llvm::Value *loadedPtr = builder.CreateLoad(sym->type, sym->value, "loadptr");
-        indices.push_back(index);
-        elementPtr = builder.CreateGEP(pointeeType, loadedPtr, indices, "ptridx");
-        elementType = pointeeType;
-    }
-    else
-    {
-        indices = {builder.getInt32(0), index};
-        elementPtr = builder.CreateGEP(sym->type, sym->value, indices, "arrayidx");
-        elementType = sym->type->getArrayElementType();
+        llvm::Value *loadedPtr = loadVariable(sym, "loadptr");
+        return builder.CreateGEP(elementType, loadedPtr, index, "ptridx");
     }
 
-    llvm::Value *value = generateExpression(arrayAssign->getValue(), elementType);
-    builder.CreateStore(value, elementPtr);
-    return value;
+    if (!sym->type->isArrayTy())
+        ERROR(line, "Indexed value is neither an array nor a pointer");
+
+    elementType = sym->type->getArrayElementType();
+    if (checked)
+        emitBoundsCheck(index, builder.getInt64(sym->type->getArrayNumElements()), guard);
+    std::vector<llvm::Value *> indices = {builder.getInt64(0), index};
+    return builder.CreateGEP(sym->type, sym->value, indices, "arrayidx");
 }
 
-llvm::Value *CodeGenerator::handleIdentifier(const NodeIdentifier *id)
+llvm::Value *CodeGenerator::handleIdentifier(const NodeIdentifier *id, llvm::Type *expectedType)
 {
     const SymbolTable::Symbol *sym = symbolTable.lookupVariable(id->getName());
     if (!sym)
         ERROR(id->getLine(), "Undefined variable: %s", id->getName().c_str());
-    return builder.CreateLoad(sym->type, sym->value, id->getName() + ".val");
+
+    if (isSliceType(expectedType) && sym->type->isArrayTy())
+    {
+        std::vector<llvm::Value *> indices = {builder.getInt64(0), builder.getInt64(0)};
+        llvm::Value *data = builder.CreateGEP(sym->type, sym->value, indices, id->getName() + ".data");
+        return makeSlice(expectedType, data, builder.getInt64(sym->type->getArrayNumElements()));
+    }
+    return loadVariable(sym, id->getName() + ".val");
+}
+
+llvm::Value *CodeGenerator::loadVariable(const SymbolTable::Symbol *sym, const std::string &name)
+{
+    if (sym->isValue)
+        return sym->value;
+    if (sym->ssaSlot >= 0)
+        return readVariable(sym->ssaSlot, builder.GetInsertBlock());
+    return builder.CreateLoad(sym->type, sym->value, name);
+}
+
+int CodeGenerator::createRestrictScope(const std::string &name)
+{
+    restrictScopes.push_back(name);
+    return static_cast<int>(restrictScopes.size() - 1);
+}
+
+void CodeGenerator::tagRestrictAccess(llvm::Value *access, const SymbolTable::Symbol *sym)
+{
+    if (sym && sym->aliasScope >= 0)
+        restrictAccesses.emplace_back(llvm::cast<llvm::Instruction>(access), sym->aliasScope);
+}
+
+void CodeGenerator::tagRestrictAccess(llvm::Value *access, const Node *pointer)
+{
+    if (auto id = dynamic_cast<const NodeIdentifier *>(pointer))
+        tagRestrictAccess(access, symbolTable.lookupVariable(id->getName()));
+}
+
+void CodeGenerator::applyRestrictScopes(llvm::Function *function)
+{
+    if (restrictScopes.empty())
+        return;
+
+    // Every restrict pointer gets its own scope; an access through one of them is
+    // declared not to alias accesses made through any of the others.
+    llvm::MDBuilder mdBuilder(context);
+    llvm::MDNode *domain = mdBuilder.createAnonymousAliasScopeDomain(function->getName());
+    std::vector<llvm::Metadata *> scopes;
+    for (const auto &name : restrictScopes)
+        scopes.push_back(mdBuilder.createAnonymousAliasScope(domain, name));
+
+    for (const auto &[access, scopeId] : restrictAccesses)
+    {
+        std::vector<llvm::Metadata *> others;
+        for (size_t i = 0; i < scopes.size(); i++)
+        {
+            if (static_cast<int>(i) != scopeId)
+                others.push_back(scopes[i]);
+        }
+
+        access->setMetadata(llvm::LLVMContext::MD_alias_scope, llvm::MDNode::get(context, scopes[scopeId]));
+        if (!others.empty())
+            access->setMetadata(llvm::LLVMContext::MD_noalias, llvm::MDNode::get(context, others));
+    }
+
+    restrictScopes.clear();
+    restrictAccesses.clear();
 }
 
 llvm::Value *CodeGenerator::handleNumber(const NodeNumber *number, llvm::Type *expectedType)
 {
-    unsigned bitWidth = expectedType->getIntegerBitWidth();
-    return llvm::ConstantInt::get(context, llvm::APInt(bitWidth, number->getValue(), true));
+    llvm::Type *scalarType = expectedType->getScalarType();
+    llvm::Constant *value = nullptr;
+
+    if (scalarType->isIntegerTy(1))
+        value = builder.getInt1(number->getValue() != 0);
+    else if (scalarType->isIntegerTy())
+        value = llvm::ConstantInt::get(scalarType, number->getValue(), true);
+    else if (scalarType->isFloatingPointTy())
+        value = llvm::ConstantFP::get(scalarType, number->getValue());
+    else if (scalarType->isPointerTy() && number->getValue() == 0)
+        value = llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(scalarType));
+    else
+        ERROR(number->getLine(), "Number literal cannot be used as a value of this type");
+
+    if (auto *vectorType = llvm::dyn_cast<llvm::FixedVectorType>(expectedType))
+        return llvm::ConstantVector::getSplat(vectorType->getElementCount(), value);
+    return value;
+}
+
+llvm::Value *CodeGenerator::handleFloat(const NodeFloat *number, llvm::Type *expectedType)
+{
+    llvm::Type *scalarType = expectedType ? expectedType->getScalarType() : builder.getDoubleTy();
+    if (!scalarType->isFloatingPointTy())
+        ERROR(number->getLine(), "Floating-point literal used where a non floating-point value is expected");
+
+    llvm::Constant *value = llvm::ConstantFP::get(scalarType, number->getValue());
+    if (auto *vectorType = llvm::dyn_cast_or_null<llvm::FixedVectorType>(expectedType))
+        return llvm::ConstantVector::getSplat(vectorType->getElementCount(), value);
+    return value;
+}
+
+static bool isComparisonOp(Token::Kind op)
+{
+    return op == Token::Kind::TOKEN_EQUAL_EQUAL || op == Token::Kind::TOKEN_BANG_EQUAL ||
+           op == Token::Kind::TOKEN_LESS || op == Token::Kind::TOKEN_LESS_EQUAL ||
+           op == Token::Kind::TOKEN_GREATER || op == Token::Kind::TOKEN_GREATER_EQUAL;
+}
+
+static bool isLogicalOp(Token::Kind op)
+{
+    return op == Token::Kind::TOKEN_AND_AND || op == Token::Kind::TOKEN_PIPE_PIPE;
 }
 
 llvm::Value *CodeGenerator::handleBinaryOp(const NodeBinaryOp *binary, llvm::Type *expectedType)
 {
-    llvm::Value *left = generateExpression(binary->getLeft(), expectedType);
-    llvm::Value *right = generateExpression(binary->getRight(), expectedType);
+    if (isLogicalOp(binary->getOp()))
+        return widenComparison(handleLogicalOp(binary), expectedType);
+
+    // Comparison operands take their type from each other, not from the result.
+    llvm::Type *operandType = expectedType;
+    if (isComparisonOp(binary->getOp()))
+        operandType = inferOperandType(binary->getLeft(), binary->getRight());
+
+    llvm::Value *left = generateExpression(binary->getLeft(), operandType);
+    llvm::Value *right = generateExpression(binary->getRight(), operandType);
     if (!left || !right)
         return nullptr;
-    left = castValue(left, expectedType);
-    right = castValue(right, expectedType);
+    left = castValue(left, operandType);
+    right = castValue(right, operandType);
+
+    if (left->getType()->isFPOrFPVectorTy())
+        return handleFloatBinaryOp(binary, left, right, expectedType);
 
     switch (binary->getOp())
     {
@@ -318,44 +535,284 @@ llvm::Value *CodeGenerator::handleBinaryOp(const NodeBinaryOp *binary, llvm::Typ
         return builder.CreateMul(left, right, "multmp");
     case Token::Kind::TOKEN_SLASH:
         return builder.CreateSDiv(left, right, "divtmp");
+    case Token::Kind::TOKEN_PERCENT:
+        return builder.CreateSRem(left, right, "remtmp");
+    case Token::Kind::TOKEN_AMPERSAND:
+        return builder.CreateAnd(left, right, "andtmp");
+    case Token::Kind::TOKEN_PIPE:
+        return builder.CreateOr(left, right, "ortmp");
+    case Token::Kind::TOKEN_CARET:
+        return builder.CreateXor(left, right, "xortmp");
+    case Token::Kind::TOKEN_SHL:
+        return builder.CreateShl(left, right, "shltmp");
+    case Token::Kind::TOKEN_SHR:
+        return builder.CreateAShr(left, right, "shrtmp");
     case Token::Kind::TOKEN_EQUAL_EQUAL:
-    {
-        llvm::Value *cmp = builder.CreateICmpEQ(left, right, "eqtmp");
-        return builder.CreateZExt(cmp, expectedType, "zexttmp");
+        return widenComparison(builder.CreateICmpEQ(left, right, "eqtmp"), expectedType);
+    case Token::Kind::TOKEN_BANG_EQUAL:
+        return widenComparison(builder.CreateICmpNE(left, right, "netmp"), expectedType);
+    case Token::Kind::TOKEN_LESS:
+        return widenComparison(builder.CreateICmpSLT(left, right, "slttmp"), expectedType);
+    case Token::Kind::TOKEN_LESS_EQUAL:
+        return widenComparison(builder.CreateICmpSLE(left, right, "sletmp"), expectedType);
+    case Token::Kind::TOKEN_GREATER:
+        return widenComparison(builder.CreateICmpSGT(left, right, "sgttmp"), expectedType);
+    case Token::Kind::TOKEN_GREATER_EQUAL:
+        return widenComparison(builder.CreateICmpSGE(left, right, "sgetmp"), expectedType);
+    default:
+        return nullptr;
     }
+}
+
+llvm::Value *CodeGenerator::handleFloatBinaryOp(const NodeBinaryOp *binary, llvm::Value *left, llvm::Value *right, llvm::Type *expectedType)
+{
+    switch (binary->getOp())
+    {
+    case Token::Kind::TOKEN_PLUS:
+        return builder.CreateFAdd(left, right, "faddtmp");
+    case Token::Kind::TOKEN_MINUS:
+        return builder.CreateFSub(left, right, "fsubtmp");
+    case Token::Kind::TOKEN_STAR:
+        return builder.CreateFMul(left, right, "fmultmp");
+    case Token::Kind::TOKEN_SLASH:
+        return builder.CreateFDiv(left, right, "fdivtmp");
+    case Token::Kind::TOKEN_PERCENT:
+        return builder.CreateFRem(left, right, "fremtmp");
+    case Token::Kind::TOKEN_AMPERSAND:
+    case Token::Kind::TOKEN_PIPE:
+    case Token::Kind::TOKEN_CARET:
+    case Token::Kind::TOKEN_SHL:
+    case Token::Kind::TOKEN_SHR:
+        ERROR(binary->getLine(), "Bitwise operators require integer operands");
+        return nullptr;
+    case Token::Kind::TOKEN_EQUAL_EQUAL:
+        return widenComparison(builder.CreateFCmpOEQ(left, right, "feqtmp"), expectedType);
     case Token::Kind::TOKEN_BANG_EQUAL:
+        return widenComparison(builder.CreateFCmpUNE(left, right, "fnetmp"), expectedType);
+    case Token::Kind::TOKEN_LESS:
+        return widenComparison(builder.CreateFCmpOLT(left, right, "flttmp"), expectedType);
+    case Token::Kind::TOKEN_LESS_EQUAL:
+        return widenComparison(builder.CreateFCmpOLE(left, right, "fletmp"), expectedType);
+    case Token::Kind::TOKEN_GREATER:
+        return widenComparison(builder.CreateFCmpOGT(left, right, "fgttmp"), expectedType);
+    case Token::Kind::TOKEN_GREATER_EQUAL:
+        return widenComparison(builder.CreateFCmpOGE(left, right, "fgetmp"), expectedType);
+    default:
+        return nullptr;
+    }
+}
+
+llvm::Value *CodeGenerator::handleLogicalOp(const NodeBinaryOp *binary)
+{
+    const bool isAnd = binary->getOp() == Token::Kind::TOKEN_AND_AND;
+    llvm::Function *function = builder.GetInsertBlock()->getParent();
+
+    llvm::Value *left = generateCondition(binary->getLeft());
+    llvm::BasicBlock *leftEnd = builder.GetInsertBlock();
+    llvm::BasicBlock *rhsBlock = llvm::BasicBlock::Create(context, isAnd ? "land.rhs" : "lor.rhs", function);
+    llvm::BasicBlock *endBlock = llvm::BasicBlock::Create(context, isAnd ? "land.end" : "lor.end", function);
+
+    if (isAnd)
+        builder.CreateCondBr(left, rhsBlock, endBlock);
+    else
+        builder.CreateCondBr(left, endBlock, rhsBlock);
+
+    builder.SetInsertPoint(rhsBlock);
+    llvm::Value *right = generateCondition(binary->getRight());
+    llvm::BasicBlock *rightEnd = builder.GetInsertBlock();
+    builder.CreateBr(endBlock);
+
+    builder.SetInsertPoint(endBlock);
+    llvm::PHINode *result = builder.CreatePHI(builder.getInt1Ty(), 2, isAnd ? "land" : "lor");
+    result->addIncoming(builder.getInt1(!isAnd), leftEnd);
+    result->addIncoming(right, rightEnd);
+    return result;
+}
+
+llvm::Value *CodeGenerator::generateCondition(const Node *node)
+{
+    llvm::Type *type = inferExpressionType(node);
+    llvm::Value *value = generateExpression(node, type ? type : builder.getInt32Ty());
+    if (!value)
+        ERROR(node->getLine(), "Invalid condition");
+
+    llvm::Type *valueType = value->getType();
+    if (valueType->isIntegerTy(1))
+        return value;
+    if (valueType->isIntegerTy())
+        return builder.CreateICmpNE(value, llvm::ConstantInt::get(valueType, 0), "tobool");
+    if (valueType->isFloatingPointTy())
+        return builder.CreateFCmpUNE(value, llvm::ConstantFP::get(valueType, 0.0), "tobool");
+    if (valueType->isPointerTy())
+        return builder.CreateIsNotNull(value, "tobool");
+
+    ERROR(node->getLine(), "Condition must be a bool, integer, floating-point or pointer value");
+    return nullptr;
+}
+
+void CodeGenerator::emitConditionalBranch(const Node *condition, llvm::BasicBlock *trueBlock, llvm::BasicBlock *falseBlock, BranchHint hint)
+{
+    // A hint describes the whole condition, so every branch it is split into
+    // favours the successor that stays on the expected path.
+    // '&&', '||' and '!' become control flow directly instead of materializing an i1 first.
+    if (auto binary = dynamic_cast<const NodeBinaryOp *>(condition); binary && isLogicalOp(binary->getOp()))
     {
-        llvm::Value *cmp = builder.CreateICmpNE(left, right, "netmp");
-        return builder.CreateZExt(cmp, expectedType, "zexttmp");
+        const bool isAnd = binary->getOp() == Token::Kind::TOKEN_AND_AND;
+        llvm::Function *function = builder.GetInsertBlock()->getParent();
+        llvm::BasicBlock *rhsBlock = llvm::BasicBlock::Create(context, isAnd ? "land.rhs" : "lor.rhs", function);
+
+        if (isAnd)
+            emitConditionalBranch(binary->getLeft(), rhsBlock, falseBlock, hint);
+        else
+            emitConditionalBranch(binary->getLeft(), trueBlock, rhsBlock, hint);
+
+        builder.SetInsertPoint(rhsBlock);
+        emitConditionalBranch(binary->getRight(), trueBlock, falseBlock, hint);
+        return;
     }
-    case Token::Kind::TOKEN_LESS:
+    if (auto unary = dynamic_cast<const NodeUnaryOp *>(condition); unary && unary->getOp() == Token::Kind::TOKEN_BANG)
     {
-        llvm::Value *cmp = builder.CreateICmpSLT(left, right, "slttmp");
-        return builder.CreateZExt(cmp, expectedType, "zexttmp");
+        const BranchHint inverted = hint == BranchHint::Likely     ? BranchHint::Unlikely
+                                    : hint == BranchHint::Unlikely ? BranchHint::Likely
+                                                                   : BranchHint::None;
+        emitConditionalBranch(unary->getOperand(), falseBlock, trueBlock, inverted);
+        return;
     }
-    case Token::Kind::TOKEN_LESS_EQUAL:
+
+    llvm::MDNode *weights = nullptr;
+    if (hint == BranchHint::Likely)
+        weights = llvm::MDBuilder(context).createBranchWeights(2000, 1);
+    else if (hint == BranchHint::Unlikely)
+        weights = llvm::MDBuilder(context).createBranchWeights(1, 2000);
+    builder.CreateCondBr(generateCondition(condition), trueBlock, falseBlock, weights);
+}
+
+llvm::Type *CodeGenerator::inferOperandType(const Node *left, const Node *right)
+{
+    llvm::Type *leftType = inferExpressionType(left);
+    llvm::Type *rightType = inferExpressionType(right);
+    if (!leftType || !rightType)
     {
-        llvm::Value *cmp = builder.CreateICmpSLE(left, right, "sletmp");
-        return builder.CreateZExt(cmp, expectedType, "zexttmp");
+        llvm::Type *known = leftType ? leftType : rightType;
+        if (known)
+            return known;
+        if (dynamic_cast<const NodeFloat *>(left) || dynamic_cast<const NodeFloat *>(right))
+            return builder.getDoubleTy();
+        return builder.getInt32Ty();
     }
-    case Token::Kind::TOKEN_GREATER:
+
+    if (leftType == rightType || leftType->isVectorTy() || leftType->isPointerTy())
+        return leftType;
+    if (rightType->isVectorTy() || rightType->isPointerTy())
+        return rightType;
+    if (leftType->isFloatingPointTy() != rightType->isFloatingPointTy())
+        return leftType->isFloatingPointTy() ? leftType : rightType;
+    return leftType->getPrimitiveSizeInBits() >= rightType->getPrimitiveSizeInBits() ? leftType : rightType;
+}
+
+llvm::Type *CodeGenerator::inferExpressionType(const Node *node)
+{
+    if (dynamic_cast<const NodeBool *>(node))
+        return builder.getInt1Ty();
+    if (dynamic_cast<const NodeString *>(node))
+        return builder.getPtrTy();
+    if (auto cast = dynamic_cast<const NodeCast *>(node))
+        return getLLVMType(cast->getTargetType());
+    if (auto id = dynamic_cast<const NodeIdentifier *>(node))
     {
-        llvm::Value *cmp = builder.CreateICmpSGT(left, right, "sgttmp");
-        return builder.CreateZExt(cmp, expectedType, "zexttmp");
+        const SymbolTable::Symbol *sym = symbolTable.lookupVariable(id->getName());
+        return sym ? sym->type : nullptr;
     }
-    case Token::Kind::TOKEN_GREATER_EQUAL:
+    if (auto assign = dynamic_cast<const NodeAssignment *>(node))
     {
-        llvm::Value *cmp = builder.CreateICmpSGE(left, right, "sgetmp");
-        return builder.CreateZExt(cmp, expectedType, "zexttmp");
+        const SymbolTable::Symbol *sym = symbolTable.lookupVariable(assign->getName());
+        return sym ? sym->type : nullptr;
     }
-    default:
+    if (auto access = dynamic_cast<const NodeArrayAccess *>(node))
+    {
+        const SymbolTable::Symbol *sym = symbolTable.lookupVariable(access->getName());
+        if (!sym)
+            return nullptr;
+        if (auto *vectorType = llvm::dyn_cast<llvm::FixedVectorType>(sym->type))
+            return vectorType->getElementType();
+        if (sym->type->isArrayTy())
+            return sym->type->getArrayElementType();
+        if (isSliceType(sym->type))
+            return getLLVMType(sym->baseType.substr(sym->baseType.find("[]") + 2));
+        if (sym->type->isPointerTy() && !sym->baseType.empty() && sym->baseType.back() == '*')
+            return getLLVMType(sym->baseType.substr(0, sym->baseType.size() - 1));
+        return nullptr;
+    }
+    if (auto call = dynamic_cast<const NodeFunctionCall *>(node))
+    {
+        llvm::Function *function = module->getFunction(call->getName());
+        return function && !function->getReturnType()->isVoidTy() ? function->getReturnType() : nullptr;
+    }
+    if (auto builtin = dynamic_cast<const NodeBuiltinCall *>(node))
+    {
+        if (isMemoryBuiltin(builtin->getName()))
+            return inferMemoryType(builtin);
+        if (!builtin->getTypeArgs().empty())
+        {
+            // Reductions and @extract are given the vector type but yield one lane of it.
+            llvm::Type *type = getLLVMType(builtin->getTypeArgs()[0]);
+            const std::string &name = builtin->getName();
+            if (type && (name == "extract" || name.rfind("reduce_", 0) == 0))
+                return type->getScalarType();
+            return type;
+        }
+        if (isBitBuiltin(builtin->getName()) && !builtin->getArgs().empty())
+            return inferExpressionType(builtin->getArgs()[0].get());
+        if (isAtomicBuiltin(builtin->getName()) && builtin->getName() != "atomic_store")
+            return inferAtomicType(builtin);
+        return nullptr;
+    }
+    if (auto await = dynamic_cast<const NodeAwait *>(node))
+    {
+        llvm::Type *resultType = getAwaitResultType(await->getOperand());
+        return resultType && !resultType->isVoidTy() ? resultType : nullptr;
+    }
+    if (auto unary = dynamic_cast<const NodeUnaryOp *>(node))
+    {
+        if (unary->getOp() == Token::Kind::TOKEN_BANG)
+            return builder.getInt1Ty();
+        if (unary->getOp() == Token::Kind::TOKEN_AMPERSAND)
+            return builder.getPtrTy();
+        auto id = dynamic_cast<const NodeIdentifier *>(unary->getOperand());
+        const SymbolTable::Symbol *sym = id ? symbolTable.lookupVariable(id->getName()) : nullptr;
+        if (sym && !sym->baseType.empty() && sym->baseType.back() == '*')
+            return getLLVMType(sym->baseType.substr(0, sym->baseType.size() - 1));
         return nullptr;
     }
+    if (auto binary = dynamic_cast<const NodeBinaryOp *>(node))
+    {
+        if (isComparisonOp(binary->getOp()) || isLogicalOp(binary->getOp()))
+        {
+            llvm::Type *operandType = inferOperandType(binary->getLeft(), binary->getRight());
+            if (auto *vectorType = llvm::dyn_cast<llvm::FixedVectorType>(operandType))
+                return llvm::FixedVectorType::get(builder.getInt1Ty(), vectorType->getNumElements());
+            return builder.getInt1Ty();
+        }
+        llvm::Type *leftType = inferExpressionType(binary->getLeft());
+        return leftType ? leftType : inferExpressionType(binary->getRight());
+    }
+    return nullptr;
+}
+
+llvm::Value *CodeGenerator::widenComparison(llvm::Value *cmp, llvm::Type *expectedType)
+{
+    if (!expectedType || expectedType == cmp->getType())
+        return cmp;
+    if (expectedType->isFPOrFPVectorTy())
+        return builder.CreateUIToFP(cmp, expectedType, "cmpfp");
+    return builder.CreateZExt(cmp, expectedType, "zexttmp");
 }
 
 llvm::Value *CodeGenerator::handleFunctionCall(const NodeFunctionCall *call, llvm::Type *expectedType)
 {
     llvm::Function *function = module->getFunction(call->getName());
+    if (!function)
+        function = getRuntimeFunction(call->getName());
     if (!function)
         ERROR(call->getLine(), "Undefined function '%s'", call->getName().c_str());
     if (function->arg_size() != call->getArgs().size())
@@ -369,10 +826,14 @@ llvm::Value *CodeGenerator::handleFunctionCall(const NodeFunctionCall *call, llv
         llvm::Value *argValue = generateExpression(arg.get(), expectedArgType);
         if (!argValue)
             return nullptr;
-        args.push_back(argValue);
+        args.push_back(castValue(argValue, expectedArgType));
         ++i;
     }
-    return builder.CreateCall(function, args, "calltmp");
+
+    llvm::CallInst *callInst = builder.CreateCall(function, args, function->getReturnType()->isVoidTy() ? "" : "calltmp");
+    if (flattenCalls && !function->isDeclaration())
+        callInst->addFnAttr(llvm::Attribute::AlwaysInline);
+    return callInst;
 }
 
 void CodeGenerator::generate(const Node *root)
@@ -382,7 +843,7 @@ void CodeGenerator::generate(const Node *root)
         for (const auto &stmt : block->getStatements())
         {
             if (auto varDecl = dynamic_cast<const NodeVariableDeclaration *>(stmt.get()))
-                generateVarDeclaration(varDecl);
+                generateGlobalDeclaration(varDecl);
             else if (auto funcDecl = dynamic_cast<const NodeFunctionDeclaration *>(stmt.get()))
                 generateFuncDeclaration(funcDecl);
             else if (auto externDecl = dynamic_cast<const NodeExternDeclaration *>(stmt.get()))
@@ -391,22 +852,139 @@ void CodeGenerator::generate(const Node *root)
     }
 }
 
-void CodeGenerator::generateRuntime()
+// Output helpers from libtvysrt.a, declared on first use so a program is free to
+// define functions of the same names. They append to a per-thread buffer that is
+// written out with write(2) when full, on flush() and at exit, instead of one printf
+// per value.
+llvm::Function *CodeGenerator::getRuntimeFunction(const std::string &name)
 {
-    llvm::FunctionType *printIntType = llvm::FunctionType::get(llvm::Type::getVoidTy(context), {llvm::Type::getInt32Ty(context)}, false);
-    llvm::Function *printIntFunc = llvm::Function::Create(printIntType, llvm::Function::ExternalLinkage, "printInt", module.get());
-    llvm::BasicBlock *entry = llvm::BasicBlock::Create(context, "entry", printIntFunc);
-    builder.SetInsertPoint(entry);
+    if (freestanding)
+        return nullptr;
+    const std::tuple<const char *, const char *, llvm::FunctionType *> functions[] = {
+        {"printInt", "tvys_print_int", llvm::FunctionType::get(builder.getVoidTy(), {builder.getInt32Ty()}, false)},
+        {"printI64", "tvys_print_i64", llvm::FunctionType::get(builder.getVoidTy(), {builder.getInt64Ty()}, false)},
+        {"printStr", "tvys_print_str", llvm::FunctionType::get(builder.getVoidTy(), {builder.getPtrTy()}, false)},
+        {"flush", "tvys_flush", llvm::FunctionType::get(builder.getVoidTy(), false)},
+    };
+    for (const auto &[sourceName, symbol, type] : functions)
+    {
+        if (name != sourceName)
+            continue;
+        llvm::FunctionCallee callee = module->getOrInsertFunction(symbol, type);
+        auto *function = llvm::cast<llvm::Function>(callee.getCallee());
+        function->addFnAttr(llvm::Attribute::NoUnwind);
+        return function;
+    }
+    return nullptr;
+}
 
-    llvm::FunctionType *printfType = llvm::FunctionType::get(llvm::IntegerType::getInt32Ty(context),
-                                                             llvm::PointerType::get(llvm::Type::getInt8Ty(context), 0), true);
-    llvm::Function *printfFunc = llvm::Function::Create(printfType, llvm::Function::ExternalLinkage, "printf", module.get());
+void CodeGenerator::requireHostedRuntime(int line, const char *feature)
+{
+    if (freestanding)
+        ERROR(line, "%s needs libtvysrt and cannot be used with --freestanding", feature);
+}
 
-    llvm::Value *formatStr = builder.CreateGlobalStringPtr("%d\n");
-    llvm::Argument *arg = &*printIntFunc->arg_begin();
-    std::vector<llvm::Value *> args = {formatStr, arg};
-    builder.CreateCall(printfFunc, args);
-    builder.CreateRetVoid();
+// With --freestanding nothing provides the C library, yet the backend still lowers
+// llvm.memcpy, llvm.memmove and llvm.memset, e.g. from aggregate copies, to calls. These
+// byte loops fill in for any the program does not define itself. They are weak so an
+// image can link faster versions, and "no-builtins" keeps the optimizer from turning
+// their loops back into calls to themselves; the vectorizer still widens them.
+void CodeGenerator::generateFreestandingRuntime()
+{
+    builder.SetCurrentDebugLocation(llvm::DebugLoc());
+    llvm::Type *ptr = builder.getPtrTy();
+    llvm::Type *sizeType = module->getDataLayout().getIntPtrType(context);
+    const std::pair<const char *, llvm::FunctionType *> functions[] = {
+        {"memcpy", llvm::FunctionType::get(ptr, {ptr, ptr, sizeType}, false)},
+        {"memmove", llvm::FunctionType::get(ptr, {ptr, ptr, sizeType}, false)},
+        {"memset", llvm::FunctionType::get(ptr, {ptr, builder.getInt32Ty(), sizeType}, false)},
+    };
+
+    for (const auto &[name, type] : functions)
+    {
+        llvm::Function *function = module->getFunction(name);
+        if (function && (!function->isDeclaration() || function->getFunctionType() != type))
+            continue;
+        if (!function)
+            function = llvm::Function::Create(type, llvm::Function::WeakAnyLinkage, name, module.get());
+        function->setLinkage(llvm::Function::WeakAnyLinkage);
+        function->addFnAttr("no-builtins");
+        function->addFnAttr(llvm::Attribute::NoUnwind);
+
+        llvm::Value *dest = function->getArg(0);
+        llvm::Value *source = function->getArg(1);
+        llvm::Value *count = function->getArg(2);
+        const std::string kind = name;
+        if (kind == "memcpy")
+        {
+            function->addParamAttr(0, llvm::Attribute::NoAlias);
+            function->addParamAttr(1, llvm::Attribute::NoAlias);
+        }
+
+        llvm::BasicBlock *entry = llvm::BasicBlock::Create(context, "entry", function);
+        llvm::BasicBlock *forward = llvm::BasicBlock::Create(context, "forward", function);
+        llvm::BasicBlock *done = llvm::BasicBlock::Create(context, "done", function);
+        builder.SetInsertPoint(entry);
+
+        // Emits `for (i = first; i != last; i += step) body(i)`, entered from the current block.
+        auto byteLoop = [&](llvm::BasicBlock *loop, llvm::Value *first, llvm::Value *last, int64_t step,
+                            const std::function<void(llvm::Value *)> &body)
+        {
+            llvm::BasicBlock *header = builder.GetInsertBlock();
+            builder.CreateCondBr(builder.CreateICmpEQ(first, last), done, loop);
+            builder.SetInsertPoint(loop);
+            llvm::PHINode *index = builder.CreatePHI(sizeType, 2, "i");
+            index->addIncoming(first, header);
+            body(index);
+            llvm::Value *next = builder.CreateAdd(index, llvm::ConstantInt::get(sizeType, step, true), "i.next");
+            index->addIncoming(next, loop);
+            builder.CreateCondBr(builder.CreateICmpEQ(next, last), done, loop);
+        };
+        auto copyByte = [&](llvm::Value *index)
+        {
+            llvm::Value *byte = builder.CreateLoad(builder.getInt8Ty(), builder.CreateGEP(builder.getInt8Ty(), source, index));
+            builder.CreateStore(byte, builder.CreateGEP(builder.getInt8Ty(), dest, index));
+        };
+
+        llvm::Value *zero = llvm::ConstantInt::get(sizeType, 0);
+        if (kind == "memset")
+        {
+            llvm::Value *value = builder.CreateTrunc(source, builder.getInt8Ty(), "byte");
+            byteLoop(forward, zero, count, 1, [&](llvm::Value *index)
+                     { builder.CreateStore(value, builder.CreateGEP(builder.getInt8Ty(), dest, index)); });
+        }
+        else if (kind == "memcpy")
+            byteLoop(forward, zero, count, 1, copyByte);
+        else
+        {
+            // Overlapping moves to a higher address copy from the end.
+            llvm::BasicBlock *backward = llvm::BasicBlock::Create(context, "backward", function);
+            llvm::BasicBlock *forwardCheck = llvm::BasicBlock::Create(context, "forward.check", function);
+            llvm::BasicBlock *backwardCheck = llvm::BasicBlock::Create(context, "backward.check", function);
+            llvm::Value *destAddress = builder.CreatePtrToInt(dest, sizeType);
+            llvm::Value *sourceAddress = builder.CreatePtrToInt(source, sizeType);
+            builder.CreateCondBr(builder.CreateICmpULE(destAddress, sourceAddress), forwardCheck, backwardCheck);
+
+            builder.SetInsertPoint(forwardCheck);
+            byteLoop(forward, zero, count, 1, copyByte);
+            builder.SetInsertPoint(backwardCheck);
+            llvm::Value *last = builder.CreateSub(count, llvm::ConstantInt::get(sizeType, 1));
+            byteLoop(backward, last, llvm::ConstantInt::get(sizeType, -1, true), -1, copyByte);
+        }
+
+        builder.SetInsertPoint(done);
+        builder.CreateRet(dest);
+    }
+}
+
+// Returns the function already named name, e.g. from an earlier ext declaration,
+// once checked against the type the source gives it.
+llvm::Function *CodeGenerator::findExistingFunction(const std::string &name, llvm::FunctionType *type, int line)
+{
+    llvm::Function *existing = module->getFunction(name);
+    if (existing && existing->getFunctionType() != type)
+        ERROR(line, "Conflicting declaration of function '%s'", name.c_str());
+    return existing;
 }
 
 void CodeGenerator::generateFuncDeclaration(const NodeFunctionDeclaration *node)
@@ -424,24 +1002,80 @@ void CodeGenerator::generateFuncDeclaration(const NodeFunctionDeclaration *node)
     if (!returnType)
         ERROR(node->getLine(), "Unknown return type: %s", node->getReturnType().c_str());
 
-    llvm::FunctionType *funcType = llvm::FunctionType::get(returnType, argTypes, false);
+    // An async fn returns the handle of its coroutine; the declared type is what awaiting it yields.
+    llvm::FunctionType *funcType = llvm::FunctionType::get(node->isAsync() ? builder.getPtrTy() : returnType, argTypes, false);
+    llvm::Function *declaration = findExistingFunction(node->getName(), funcType, node->getLine());
+    if (declaration && !declaration->isDeclaration())
+        ERROR(node->getLine(), "Function '%s' is already defined", node->getName().c_str());
     llvm::Function *function = llvm::Function::Create(funcType, llvm::Function::ExternalLinkage, node->getName(), module.get());
+    if (declaration)
+    {
+        // A definition replaces an earlier ext declaration of the same function.
+        declaration->replaceAllUsesWith(function);
+        function->takeName(declaration);
+        declaration->eraseFromParent();
+    }
+    if (node->isAsync())
+    {
+        // The call only creates the task, so claims about the body do not hold for it.
+        for (const auto &attr : node->getAttributes())
+        {
+            if (attr.getName() == "pure" || attr.getName() == "noreturn")
+                ERROR(attr.getLine(), "Attribute '%s' cannot be used on an async fn", attr.getName().c_str());
+        }
+    }
+    applyFunctionAttributes(function, node->getAttributes(), true);
+    if (node->isAsync())
+    {
+        requireHostedRuntime(node->getLine(), "'async fn'");
+        asyncResultTypes[node->getName()] = returnType;
+    }
     currentFunction = function;
     llvm::BasicBlock *entry = llvm::BasicBlock::Create(context, "entry", function);
     builder.SetInsertPoint(entry);
+    beginDebugFunction(function, node, node->getLine());
 
     symbolTable.enterScope();
+    resetSSAState();
+    collectAddressTaken(node->getBody().get());
     unsigned idx = 0;
     for (auto &arg : function->args())
     {
         std::string argName = node->getArgs()[idx].first;
         arg.setName(argName);
-        llvm::AllocaInst *alloca = createEntryBlockAlloca(function, argName, arg.getType());
-        builder.CreateStore(&arg, alloca);
-        symbolTable.addVariable(argName, alloca, arg.getType(), node->getArgs()[idx].second);
+
+        std::string argType = node->getArgs()[idx].second;
+        int aliasScope = -1;
+        if (argType.rfind("restrict ", 0) == 0)
+        {
+            argType = argType.substr(9);
+            if (!arg.getType()->isPointerTy())
+                ERROR(node->getLine(), "'restrict' can only qualify pointer parameters: %s", argName.c_str());
+            function->addParamAttr(idx, llvm::Attribute::NoAlias);
+            aliasScope = createRestrictScope(node->getName() + "." + argName);
+        }
+        if (canPromote(argName, arg.getType()))
+        {
+            SymbolTable::Symbol &sym = symbolTable.addVariable(argName, nullptr, arg.getType(), argType);
+            sym.aliasScope = aliasScope;
+            sym.ssaSlot = declareSSAVariable(argName, arg.getType());
+            writeVariable(sym.ssaSlot, entry, &arg);
+            ssaVariables[sym.ssaSlot].debugVariable = createDebugVariable(argName, argType, node->getLine(), idx + 1);
+            emitDebugValue(ssaVariables[sym.ssaSlot].debugVariable, &arg);
+        }
+        else
+        {
+            llvm::AllocaInst *alloca = createEntryBlockAlloca(function, argName, arg.getType());
+            builder.CreateStore(&arg, alloca);
+            symbolTable.addVariable(argName, alloca, arg.getType(), argType).aliasScope = aliasScope;
+            emitDebugDeclare(createDebugVariable(argName, argType, node->getLine(), idx + 1), alloca);
+        }
         idx++;
     }
 
+    if (node->isAsync())
+        beginCoroutine(function, returnType, node->getLine());
+
     hasReturn = false;
     if (const NodeBlock *body = dynamic_cast<const NodeBlock *>(node->getBody().get()))
     {
@@ -449,16 +1083,87 @@ void CodeGenerator::generateFuncDeclaration(const NodeFunctionDeclaration *node)
             generateStatement(stmt.get());
     }
 
-    if (!hasReturn)
+    // Falling off the end of the body returns at its closing brace.
+    if (const NodeBlock *body = dynamic_cast<const NodeBlock *>(node->getBody().get()))
+        setDebugLocation(body->getEndLine());
+    llvm::BasicBlock *lastBlock = builder.GetInsertBlock();
+    if (!lastBlock->getTerminator())
     {
-        if (returnType->isVoidTy())
+        if (returnType->isVoidTy() && node->isAsync())
+            builder.CreateBr(coroutine.finalBlock);
+        else if (returnType->isVoidTy())
             builder.CreateRetVoid();
-        else
+        else if (!hasReturn)
             ERROR(node->getLine(), "Function '%s' with return type '%s' must have a return statement.", node->getName().c_str(), node->getReturnType().c_str());
+        else if (lastBlock != entry && llvm::pred_empty(lastBlock))
+            builder.CreateUnreachable();
+        else
+            ERROR(node->getLine(), "Function '%s' can reach its end without returning a value", node->getName().c_str());
     }
 
+    if (node->isAsync())
+        finishCoroutine();
+    finishDebugFunction();
+
+    applyRestrictScopes(function);
+    resetSSAState();
     symbolTable.exitScope();
     currentFunction = nullptr;
+    flattenCalls = false;
+}
+
+void CodeGenerator::applyFunctionAttributes(llvm::Function *function, const std::vector<Attribute> &attributes, bool isDefinition)
+{
+    for (const auto &attr : attributes)
+    {
+        const std::string &name = attr.getName();
+        const auto &args = attr.getArgs();
+        if (args.size() > 1)
+            ERROR(attr.getLine(), "Function attribute '%s' takes at most one argument", name.c_str());
+        const std::string arg = args.empty() ? "" : args[0];
+
+        if (name == "inline" && arg.empty())
+            function->addFnAttr(llvm::Attribute::InlineHint);
+        else if (name == "inline" && arg == "always")
+            function->addFnAttr(llvm::Attribute::AlwaysInline);
+        else if ((name == "inline" && arg == "never") || (name == "noinline" && arg.empty()))
+            function->addFnAttr(llvm::Attribute::NoInline);
+        else if (name == "hot" && arg.empty())
+            function->addFnAttr(llvm::Attribute::Hot);
+        else if (name == "cold" && arg.empty())
+        {
+            function->addFnAttr(llvm::Attribute::Cold);
+            function->addFnAttr(llvm::Attribute::OptimizeForSize);
+        }
+        else if (name == "pure" && (arg.empty() || arg == "read"))
+        {
+            // A pure function has no side effects, so it also cannot unwind or run forever;
+            // without these the optimizer may not delete or hoist calls to it.
+            if (arg.empty())
+                function->setDoesNotAccessMemory();
+            else
+                function->setOnlyReadsMemory();
+            function->setDoesNotThrow();
+            function->addFnAttr(llvm::Attribute::WillReturn);
+        }
+        else if (name == "noreturn" && arg.empty())
+            function->setDoesNotReturn();
+        else if (name == "flatten" && arg.empty())
+        {
+            if (!isDefinition)
+                ERROR(attr.getLine(), "Attribute 'flatten' requires a function body");
+            flattenCalls = true;
+        }
+        else
+            ERROR(attr.getLine(), "Unknown function attribute '%s%s'", name.c_str(), arg.empty() ? "" : ("(" + arg + ")").c_str());
+    }
+
+    if (function->hasFnAttribute(llvm::Attribute::AlwaysInline) && function->hasFnAttribute(llvm::Attribute::NoInline))
+        ERROR(attributes.front().getLine(), "Function '%s' cannot be both inline(always) and noinline", function->getName().str().c_str());
+    if (function->hasFnAttribute(llvm::Attribute::Hot) && function->hasFnAttribute(llvm::Attribute::Cold))
+        ERROR(attributes.front().getLine(), "Function '%s' cannot be both hot and cold", function->getName().str().c_str());
+    if (function->doesNotReturn() && function->hasFnAttribute(llvm::Attribute::WillReturn))
+        ERROR(attributes.front().getLine(), "Function '%s' cannot be both pure and noreturn", function->getName().str().c_str());
 }
 
 void CodeGenerator::generateExternDeclaration(const NodeExternDeclaration *node)
@@ -477,17 +1182,29 @@ void CodeGenerator::generateExternDeclaration(const NodeExternDeclaration *node)
         ERROR(node->getLine(), "Unknown return type: %s", node->getReturnType().c_str());
 
     llvm::FunctionType *funcType = llvm::FunctionType::get(returnType, argTypes, false);
-    llvm::Function::Create(funcType, llvm::Function::ExternalLinkage, node->getName(), module.get());
+    llvm::Function *function = findExistingFunction(node->getName(), funcType, node->getLine());
+    if (!function)
+        function = llvm::Function::Create(funcType, llvm::Function::ExternalLinkage, node->getName(), module.get());
+    applyFunctionAttributes(function, node->getAttributes(), false);
 }
 
 void CodeGenerator::generateStatement(const Node *stmt)
 {
+    // Statements after a return are unreachable and would follow the block's terminator.
+    if (builder.GetInsertBlock()->getTerminator())
+        return;
+    setDebugLocation(stmt->getLine());
+
     if (auto varDecl = dynamic_cast<const NodeVariableDeclaration *>(stmt))
         generateVarDeclaration(varDecl);
     else if (auto whileStmt = dynamic_cast<const NodeWhile *>(stmt))
         generateWhileStatement(whileStmt);
+    else if (auto forStmt = dynamic_cast<const NodeFor *>(stmt))
+        generateForStatement(forStmt);
     else if (auto ifStmt = dynamic_cast<const NodeIf *>(stmt))
         generateIfStatement(ifStmt);
+    else if (auto matchStmt = dynamic_cast<const NodeMatch *>(stmt))
+        generateMatchStatement(matchStmt);
     else if (auto returnStmt = dynamic_cast<const NodeReturn *>(stmt))
         generateReturn(returnStmt);
     else
@@ -496,48 +1213,448 @@ void CodeGenerator::generateStatement(const Node *stmt)
 
 llvm::Value *CodeGenerator::generateVarDeclaration(const NodeVariableDeclaration *node)
 {
+    if (node->isStatic() || node->isConst() || node->isThreadLocal())
+        return generateGlobalDeclaration(node);
+
     llvm::Type *llvmType = getLLVMType(node->getType());
     if (!llvmType)
         ERROR(node->getLine(), "Unknown type: %s", node->getType().c_str());
 
-    llvm::AllocaInst *alloca = createEntryBlockAlloca(currentFunction, node->getName(), llvmType);
-    symbolTable.addVariable(node->getName(), alloca, llvmType, node->getType());
+    std::string baseType = node->getType();
+    int aliasScope = -1;
+    if (baseType.rfind("restrict ", 0) == 0)
+    {
+        baseType = baseType.substr(9);
+        if (!llvmType->isPointerTy())
+            ERROR(node->getLine(), "'restrict' can only qualify pointer variables: %s", node->getName().c_str());
+        aliasScope = createRestrictScope(node->getName());
+    }
 
-    llvm::Constant *defaultInit = llvm::Constant::getNullValue(llvmType);
-    builder.CreateStore(defaultInit, alloca);
+    if (llvmType->isAggregateType())
+    {
+        llvm::AllocaInst *alloca = createEntryBlockAlloca(currentFunction, node->getName(), llvmType);
+        symbolTable.addVariable(node->getName(), alloca, llvmType, baseType).aliasScope = aliasScope;
+        emitDebugDeclare(createDebugVariable(node->getName(), baseType, node->getLine()), alloca);
+        initializeAggregate(alloca, llvmType, node->getInitializer(), node->getName(), node->getLine());
+        return alloca;
+    }
 
     if (node->getInitializer())
+        checkTaskValue(baseType, node->getInitializer(), node->getLine());
+
+    // The initializer is evaluated before the name is bound, so it sees any outer variable it shadows.
+    llvm::Value *initializer = node->getInitializer() ? generateExpression(node->getInitializer(), llvmType) : nullptr;
+    initializer = initializer ? castValue(initializer, llvmType) : llvm::Constant::getNullValue(llvmType);
+
+    if (canPromote(node->getName(), llvmType))
     {
-        llvm::Value *initializer = generateExpression(node->getInitializer(), llvmType);
-        if (initializer)
-            builder.CreateStore(initializer, alloca);
+        SymbolTable::Symbol &sym = symbolTable.addVariable(node->getName(), nullptr, llvmType, baseType);
+        sym.aliasScope = aliasScope;
+        sym.ssaSlot = declareSSAVariable(node->getName(), llvmType);
+        writeVariable(sym.ssaSlot, builder.GetInsertBlock(), initializer);
+        ssaVariables[sym.ssaSlot].debugVariable = createDebugVariable(node->getName(), baseType, node->getLine());
+        emitDebugValue(ssaVariables[sym.ssaSlot].debugVariable, initializer);
+        return initializer;
     }
 
+    llvm::AllocaInst *alloca = createEntryBlockAlloca(currentFunction, node->getName(), llvmType);
+    symbolTable.addVariable(node->getName(), alloca, llvmType, baseType).aliasScope = aliasScope;
+    emitDebugDeclare(createDebugVariable(node->getName(), baseType, node->getLine()), alloca);
+    builder.CreateStore(initializer, alloca);
     return alloca;
 }
 
+llvm::Value *CodeGenerator::generateGlobalDeclaration(const NodeVariableDeclaration *node)
+{
+    std::string baseType = node->getType();
+    if (baseType.rfind("restrict ", 0) == 0)
+        ERROR(node->getLine(), "'restrict' cannot qualify global variable '%s'", node->getName().c_str());
+
+    llvm::Type *llvmType = getLLVMType(baseType);
+    if (!llvmType || llvmType->isVoidTy())
+        ERROR(node->getLine(), "Unknown type: %s", node->getType().c_str());
+    if (node->isConst() && !node->getInitializer())
+        ERROR(node->getLine(), "Constant '%s' needs an initializer", node->getName().c_str());
+    if (node->isConst() && node->isThreadLocal())
+        ERROR(node->getLine(), "Constant '%s' cannot be thread_local", node->getName().c_str());
+
+    llvm::Constant *initializer = llvm::Constant::getNullValue(llvmType);
+    if (node->getInitializer())
+    {
+        initializer = getConstantInitializer(node->getInitializer(), llvmType);
+        if (!initializer)
+            ERROR(node->getLine(), "Initializer of '%s' must be a constant expression", node->getName().c_str());
+    }
+
+    // Module-level variables are visible to other objects unless declared static;
+    // function-level ones keep their storage private to the defining function.
+    // Constants land in .rodata, zero-initialized data in .bss and the rest in .data.
+    llvm::GlobalValue::LinkageTypes linkage = llvm::GlobalValue::ExternalLinkage;
+    std::string globalName = node->getName();
+    if (currentFunction)
+    {
+        linkage = llvm::GlobalValue::InternalLinkage;
+        globalName = currentFunction->getName().str() + "." + globalName;
+    }
+    else if (node->isStatic())
+        linkage = llvm::GlobalValue::InternalLinkage;
+
+    if (!currentFunction && module->getNamedGlobal(globalName))
+        ERROR(node->getLine(), "Redefinition of global '%s'", node->getName().c_str());
+
+    auto *global = new llvm::GlobalVariable(*module, llvmType, node->isConst(), linkage, initializer, globalName);
+    global->setAlignment(module->getDataLayout().getPreferredAlign(global));
+    if (node->isConst() && linkage != llvm::GlobalValue::ExternalLinkage)
+        global->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+    if (node->isThreadLocal())
+        global->setThreadLocal(true);
+    emitDebugGlobal(global, node->getName(), baseType, node->getLine());
+
+    symbolTable.addVariable(node->getName(), global, llvmType, baseType).isConst = node->isConst();
+    return global;
+}
+
+void CodeGenerator::initializeAggregate(llvm::AllocaInst *alloca, llvm::Type *type, const Node *initializer, const std::string &name, int line)
+{
+    const uint64_t size = module->getDataLayout().getTypeAllocSize(type);
+    auto literal = dynamic_cast<const NodeArrayLiteral *>(initializer);
+
+    if (initializer && !literal)
+    {
+        if (llvm::Value *value = generateExpression(initializer, type))
+        {
+            builder.CreateStore(castValue(value, type), alloca);
+            return;
+        }
+    }
+    else if (literal)
+    {
+        if (!type->isArrayTy())
+            ERROR(line, "Array literal cannot initialize '%s'", name.c_str());
+
+        // Constant literals live once in read-only data and are copied in with a
+        // single memcpy instead of one store per element.
+        if (llvm::Constant *constant = getConstantInitializer(literal, type))
+        {
+            if (!constant->isNullValue())
+            {
+                const std::string prefix = currentFunction ? currentFunction->getName().str() + "." : "";
+                auto *global = new llvm::GlobalVariable(*module, type, true, llvm::GlobalValue::PrivateLinkage, constant, "__const." + prefix + name);
+                global->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+                global->setAlignment(alloca->getAlign());
+                builder.CreateMemCpy(alloca, alloca->getAlign(), global, global->getAlign(), size);
+                return;
+            }
+        }
+        else
+        {
+            const bool zeroed = !literalFillsType(literal, type);
+            if (zeroed)
+                builder.CreateMemSet(alloca, builder.getInt8(0), size, alloca->getAlign());
+            storeArrayLiteral(alloca, type, literal, zeroed);
+            return;
+        }
+    }
+
+    builder.CreateMemSet(alloca, builder.getInt8(0), size, alloca->getAlign());
+}
+
+static uint64_t checkLiteralLength(const NodeArrayLiteral *literal, llvm::Type *type)
+{
+    const uint64_t count = type->isArrayTy() ? type->getArrayNumElements() : llvm::cast<llvm::FixedVectorType>(type)->getNumElements();
+    if (literal->getElements().size() > count)
+        ERROR(literal->getLine(), "Array literal has %zu elements but its type holds only %llu",
+              literal->getElements().size(), static_cast<unsigned long long>(count));
+    return count;
+}
+
+bool CodeGenerator::literalFillsType(const NodeArrayLiteral *literal, llvm::Type *type)
+{
+    if (literal->getElements().size() != checkLiteralLength(literal, type))
+        return false;
+
+    llvm::Type *elementType = type->getArrayElementType();
+    for (const auto &element : literal->getElements())
+    {
+        auto nested = dynamic_cast<const NodeArrayLiteral *>(element.get());
+        if (nested && elementType->isArrayTy() && !literalFillsType(nested, elementType))
+            return false;
+    }
+    return true;
+}
+
+void CodeGenerator::storeArrayLiteral(llvm::Value *ptr, llvm::Type *type, const NodeArrayLiteral *literal, bool zeroed)
+{
+    checkLiteralLength(literal, type);
+    llvm::Type *elementType = type->getArrayElementType();
+    const auto &elements = literal->getElements();
+
+    for (size_t i = 0; i < elements.size(); i++)
+    {
+        llvm::Value *elementPtr = builder.CreateConstInBoundsGEP2_64(type, ptr, 0, i, "elem");
+        auto nested = dynamic_cast<const NodeArrayLiteral *>(elements[i].get());
+        if (nested && elementType->isArrayTy())
+        {
+            storeArrayLiteral(elementPtr, elementType, nested, zeroed);
+            continue;
+        }
+
+        llvm::Constant *constant = getConstantInitializer(elements[i].get(), elementType);
+        if (zeroed && constant && constant->isNullValue())
+            continue;
+
+        llvm::Value *value = constant ? constant : generateExpression(elements[i].get(), elementType);
+        if (!value)
+            ERROR(literal->getLine(), "Invalid array literal element");
+        builder.CreateStore(castValue(value, elementType), elementPtr);
+    }
+}
+
+llvm::Constant *CodeGenerator::getConstantInitializer(const Node *node, llvm::Type *type)
+{
+    if (auto number = dynamic_cast<const NodeNumber *>(node))
+    {
+        if (type->isIntegerTy())
+            return llvm::ConstantInt::get(type, number->getValue(), true);
+        if (type->isFloatingPointTy())
+            return llvm::ConstantFP::get(type, number->getValue());
+        if (type->isPointerTy() && number->getValue() == 0)
+            return llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(type));
+        return nullptr;
+    }
+    if (auto number = dynamic_cast<const NodeFloat *>(node))
+        return type->isFloatingPointTy() ? llvm::ConstantFP::get(type, number->getValue()) : nullptr;
+    if (auto str = dynamic_cast<const NodeString *>(node))
+        return type->isPointerTy() ? getStringConstant(str->getValue()) : nullptr;
+
+    auto literal = dynamic_cast<const NodeArrayLiteral *>(node);
+    if (!literal || (!type->isArrayTy() && !type->isVectorTy()))
+        return nullptr;
+
+    const uint64_t count = checkLiteralLength(literal, type);
+    llvm::Type *elementType = type->isArrayTy() ? type->getArrayElementType() : llvm::cast<llvm::VectorType>(type)->getElementType();
+
+    std::vector<llvm::Constant *> values;
+    for (const auto &element : literal->getElements())
+    {
+        llvm::Constant *value = getConstantInitializer(element.get(), elementType);
+        if (!value)
+            return nullptr;
+        values.push_back(value);
+    }
+    values.resize(count, llvm::Constant::getNullValue(elementType));
+
+    if (auto *arrayType = llvm::dyn_cast<llvm::ArrayType>(type))
+        return llvm::ConstantArray::get(arrayType, values);
+    return llvm::ConstantVector::get(values);
+}
+
+llvm::Value *CodeGenerator::handleArrayLiteral(const NodeArrayLiteral *node, llvm::Type *expectedType)
+{
+    if (!expectedType || (!expectedType->isArrayTy() && !expectedType->isVectorTy()))
+        ERROR(node->getLine(), "Array literal needs an array or vector type");
+
+    if (llvm::Constant *constant = getConstantInitializer(node, expectedType))
+        return constant;
+
+    const bool isArray = expectedType->isArrayTy();
+    llvm::Type *elementType = isArray ? expectedType->getArrayElementType() : llvm::cast<llvm::VectorType>(expectedType)->getElementType();
+    const auto &elements = node->getElements();
+
+    llvm::Value *result = llvm::Constant::getNullValue(expectedType);
+    for (size_t i = 0; i < elements.size(); i++)
+    {
+        llvm::Value *value = generateCastExpression(elements[i].get(), elementType);
+        if (isArray)
+            result = builder.CreateInsertValue(result, value, i);
+        else
+            result = builder.CreateInsertElement(result, value, builder.getInt64(i));
+    }
+    return result;
+}
+
 void CodeGenerator::generateWhileStatement(const NodeWhile *node)
 {
     llvm::Function *function = builder.GetInsertBlock()->getParent();
     llvm::BasicBlock *condBlock = llvm::BasicBlock::Create(context, "while.cond", function);
     llvm::BasicBlock *bodyBlock = llvm::BasicBlock::Create(context, "while.body", function);
     llvm::BasicBlock *afterBlock = llvm::BasicBlock::Create(context, "while.end", function);
+    unsealedBlocks.insert(condBlock);
 
     builder.CreateBr(condBlock);
 
     builder.SetInsertPoint(condBlock);
-    llvm::Value *condValue = generateExpression(node->getCondition(), builder.getInt32Ty());
-    if (!condValue)
-        ERROR(node->getLine(), "Invalid while condition");
+    emitConditionalBranch(node->getCondition(), bodyBlock, afterBlock, node->getHint());
+    builder.SetInsertPoint(bodyBlock);
+    symbolTable.enterScope();
+    if (auto bodyNode = dynamic_cast<const NodeBlock *>(node->getBody()))
+    {
+        for (const auto &stmt : bodyNode->getStatements())
+        {
+            generateStatement(stmt.get());
+        }
+    }
+    else
+        generateStatement(node->getBody());
+    symbolTable.exitScope();
+
+    setDebugLocation(node->getLine());
+    if (!builder.GetInsertBlock()->getTerminator())
+    {
+        llvm::BranchInst *backEdge = builder.CreateBr(condBlock);
+        if (llvm::MDNode *loopID = buildLoopMetadata(node->getAttributes()))
+            backEdge->setMetadata(llvm::LLVMContext::MD_loop, loopID);
+    }
+    sealBlock(condBlock);
+    builder.SetInsertPoint(afterBlock);
+}
+
+void CodeGenerator::generateForStatement(const NodeFor *node)
+{
+    // Without the runtime's thread pool a parallel for runs serially, keeping its loop hints.
+    if (node->isParallel() && !freestanding)
+    {
+        generateParallelFor(node);
+        return;
+    }
+
+    llvm::Type *indexType = builder.getInt64Ty();
 
-    llvm::Value *condBool = builder.CreateICmpNE(
-        condValue,
-        llvm::ConstantInt::get(builder.getInt32Ty(), 0),
-        "whilecond");
+    // Bounds and step are evaluated once, before the loop, so the trip count is loop-invariant.
+    llvm::Value *start = generateCastExpression(node->getStart(), indexType);
+    llvm::Value *end = generateCastExpression(node->getEnd(), indexType);
+    llvm::Value *step = builder.getInt64(1);
+    if (node->getStep())
+        step = generateCastExpression(node->getStep(), indexType);
+
+    // The direction of a non-constant step is only known at run time, where the exit
+    // test follows its sign; a zero step traps instead of looping forever.
+    bool descending = false;
+    if (auto *constantStep = llvm::dyn_cast<llvm::ConstantInt>(step))
+    {
+        if (constantStep->isZero())
+            ERROR(node->getLine(), "For loop step cannot be zero");
+        descending = constantStep->isNegative();
+    }
+    else
+    {
+        llvm::Function *function = builder.GetInsertBlock()->getParent();
+        llvm::BasicBlock *trapBlock = llvm::BasicBlock::Create(context, "for.zero.step", function);
+        llvm::BasicBlock *loopBlock = llvm::BasicBlock::Create(context, "for.step.ok", function);
+        builder.CreateCondBr(builder.CreateICmpEQ(step, builder.getInt64(0), "step.zero"), trapBlock, loopBlock,
+                             llvm::MDBuilder(context).createBranchWeights(1, 2000));
+        builder.SetInsertPoint(trapBlock);
+        builder.CreateIntrinsic(llvm::Intrinsic::trap, {}, {});
+        builder.CreateUnreachable();
+        builder.SetInsertPoint(loopBlock);
+    }
+
+    emitForRange(node, start, end, step, descending);
+}
+
+void CodeGenerator::emitForRange(const NodeFor *node, llvm::Value *start, llvm::Value *end, llvm::Value *step, bool descending)
+{
+    // Hoisted checks cover [start, end), which only holds for a step known to be positive.
+    std::vector<BoundsCheckCandidate> hoisted;
+    if (boundsChecks && !descending && llvm::isa<llvm::ConstantInt>(step))
+        hoisted = elideBoundsChecks(node, start, end);
+
+    if (hoisted.empty())
+    {
+        emitCountedLoop(node, start, end, step, descending);
+        return;
+    }
+
+    // The checks that depend on runtime bounds are tested once up front, and each of
+    // those accesses passes when that test did. The body is generated once; since the
+    // guard is loop-invariant, loop unswitching can version the loop into a copy with
+    // the checks and one without them.
+    llvm::Value *guard = emitBoundsGuard(hoisted, start, end);
+    for (const auto &candidate : hoisted)
+        guardedIndices[candidate.index] = guard;
+    emitCountedLoop(node, start, end, step, descending);
+    for (const auto &candidate : hoisted)
+        guardedIndices.erase(candidate.index);
+}
+
+void CodeGenerator::emitCountedLoop(const NodeFor *node, llvm::Value *start, llvm::Value *end, llvm::Value *step, bool descending)
+{
+    llvm::Function *function = builder.GetInsertBlock()->getParent();
+    llvm::Type *indexType = builder.getInt64Ty();
+
+    llvm::BasicBlock *preheader = builder.GetInsertBlock();
+    llvm::Value *ascending = llvm::isa<llvm::ConstantInt>(step) ? nullptr : builder.CreateICmpSGT(step, builder.getInt64(0), "step.up");
+
+    // Every index that reaches for.inc lies strictly inside the range, so the increment
+    // cannot overflow for a unit step, or for a constant step when the constant end
+    // leaves room for one more step. Integers wrap, so other loops may step past the
+    // ends of i64 and count their iterations instead of comparing the index.
+    bool noWrap = false;
+    if (auto *constantStep = llvm::dyn_cast<llvm::ConstantInt>(step))
+    {
+        const int64_t stepValue = constantStep->getSExtValue();
+        int64_t last;
+        if (stepValue == 1 || stepValue == -1)
+            noWrap = true;
+        else if (auto *constantEnd = llvm::dyn_cast<llvm::ConstantInt>(end))
+        {
+            const int64_t endValue = constantEnd->getSExtValue();
+            noWrap = stepValue > 0 ? endValue == INT64_MIN || !__builtin_add_overflow(endValue - 1, stepValue, &last)
+                                   : endValue == INT64_MAX || !__builtin_add_overflow(endValue + 1, stepValue, &last);
+        }
+    }
+
+    llvm::Value *tripCount = nullptr;
+    if (!noWrap)
+    {
+        llvm::Value *zero = builder.getInt64(0);
+        llvm::Value *upDistance = builder.CreateSelect(builder.CreateICmpSLT(start, end), builder.CreateSub(end, start), zero, "for.up.dist");
+        llvm::Value *downDistance = builder.CreateSelect(builder.CreateICmpSGT(start, end), builder.CreateSub(start, end), zero, "for.down.dist");
+        llvm::Value *distance = upDistance;
+        llvm::Value *stride = step;
+        if (ascending)
+        {
+            distance = builder.CreateSelect(ascending, upDistance, downDistance, "for.dist");
+            stride = builder.CreateSelect(ascending, step, builder.CreateNeg(step), "for.stride");
+        }
+        else if (descending)
+        {
+            distance = downDistance;
+            stride = builder.CreateNeg(step, "for.stride");
+        }
+        // Distances and strides are unsigned here; (distance - 1) / stride + 1 rounds up without overflowing.
+        llvm::Value *rounded = builder.CreateAdd(builder.CreateUDiv(builder.CreateSub(distance, builder.getInt64(1)), stride), builder.getInt64(1));
+        tripCount = builder.CreateSelect(builder.CreateICmpEQ(distance, zero), zero, rounded, "for.trips");
+    }
 
+    llvm::BasicBlock *condBlock = llvm::BasicBlock::Create(context, "for.cond", function);
+    llvm::BasicBlock *bodyBlock = llvm::BasicBlock::Create(context, "for.body", function);
+    llvm::BasicBlock *incBlock = llvm::BasicBlock::Create(context, "for.inc", function);
+    llvm::BasicBlock *afterBlock = llvm::BasicBlock::Create(context, "for.end", function);
+    unsealedBlocks.insert(condBlock);
+
+    builder.CreateBr(condBlock);
+
+    builder.SetInsertPoint(condBlock);
+    llvm::PHINode *index = builder.CreatePHI(indexType, 2, node->getVarName());
+    index->addIncoming(start, preheader);
+    llvm::PHINode *counter = nullptr;
+    llvm::Value *condBool = nullptr;
+    if (tripCount)
+    {
+        counter = builder.CreatePHI(indexType, 2, "for.count");
+        counter->addIncoming(builder.getInt64(0), preheader);
+        condBool = builder.CreateICmpULT(counter, tripCount, "forcond");
+    }
+    else
+        condBool = descending ? builder.CreateICmpSGT(index, end, "forcond")
+                              : builder.CreateICmpSLT(index, end, "forcond");
     builder.CreateCondBr(condBool, bodyBlock, afterBlock);
+
     builder.SetInsertPoint(bodyBlock);
     symbolTable.enterScope();
+    symbolTable.addValue(node->getVarName(), index, indexType, "i64");
+    emitDebugValue(createDebugVariable(node->getVarName(), "i64", node->getLine()), index);
     if (auto bodyNode = dynamic_cast<const NodeBlock *>(node->getBody()))
     {
         for (const auto &stmt : bodyNode->getStatements())
@@ -548,10 +1665,84 @@ void CodeGenerator::generateWhileStatement(const NodeWhile *node)
     else
         generateStatement(node->getBody());
     symbolTable.exitScope();
-    builder.CreateBr(condBlock);
+
+    setDebugLocation(node->getLine());
+    if (!builder.GetInsertBlock()->getTerminator())
+        builder.CreateBr(incBlock);
+
+    builder.SetInsertPoint(incBlock);
+    llvm::Value *next = noWrap ? builder.CreateNSWAdd(index, step, node->getVarName() + ".next")
+                               : builder.CreateAdd(index, step, node->getVarName() + ".next");
+    if (counter)
+        counter->addIncoming(builder.CreateNUWAdd(counter, builder.getInt64(1), "for.count.next"), incBlock);
+    llvm::BranchInst *backEdge = builder.CreateBr(condBlock);
+    if (llvm::MDNode *loopID = buildLoopMetadata(node->getAttributes()))
+        backEdge->setMetadata(llvm::LLVMContext::MD_loop, loopID);
+    index->addIncoming(next, incBlock);
+    sealBlock(condBlock);
+
     builder.SetInsertPoint(afterBlock);
 }
 
+llvm::MDNode *CodeGenerator::buildLoopMetadata(const std::vector<Attribute> &attributes)
+{
+    if (attributes.empty())
+        return nullptr;
+
+    std::vector<llvm::Metadata *> operands = {nullptr};
+    auto addHint = [&](const char *name, llvm::Constant *value)
+    {
+        operands.push_back(llvm::MDNode::get(context, {llvm::MDString::get(context, name), llvm::ConstantAsMetadata::get(value)}));
+    };
+    auto countArg = [&](const Attribute &attr) -> unsigned
+    {
+        if (attr.getArgs().size() != 1)
+            ERROR(attr.getLine(), "Loop attribute '%s' expects a single count", attr.getName().c_str());
+        char *end = nullptr;
+        unsigned long count = strtoul(attr.getArgs()[0].c_str(), &end, 10);
+        if (*end != '\0' || count == 0)
+            ERROR(attr.getLine(), "Invalid count for loop attribute '%s': %s", attr.getName().c_str(), attr.getArgs()[0].c_str());
+        return static_cast<unsigned>(count);
+    };
+
+    for (const auto &attr : attributes)
+    {
+        const std::string &name = attr.getName();
+        if (name == "vectorize")
+        {
+            if (!attr.getArgs().empty())
+                addHint("llvm.loop.vectorize.width", builder.getInt32(countArg(attr)));
+            addHint("llvm.loop.vectorize.enable", builder.getTrue());
+        }
+        else if (name == "no_vectorize")
+        {
+            addHint("llvm.loop.vectorize.width", builder.getInt32(1));
+            addHint("llvm.loop.vectorize.enable", builder.getFalse());
+        }
+        else if (name == "interleave")
+            addHint("llvm.loop.interleave.count", builder.getInt32(countArg(attr)));
+        else if (name == "unroll")
+        {
+            if (attr.getArgs().empty())
+                operands.push_back(llvm::MDNode::get(context, {llvm::MDString::get(context, "llvm.loop.unroll.enable")}));
+            else
+                addHint("llvm.loop.unroll.count", builder.getInt32(countArg(attr)));
+        }
+        else if (name == "no_unroll")
+            operands.push_back(llvm::MDNode::get(context, {llvm::MDString::get(context, "llvm.loop.unroll.disable")}));
+        else if (name == "distribute")
+            addHint("llvm.loop.distribute.enable", builder.getTrue());
+        else if (name == "grain")
+            continue;
+        else
+            ERROR(attr.getLine(), "Unknown loop attribute '%s'", name.c_str());
+    }
+
+    llvm::MDNode *loopID = llvm::MDNode::getDistinct(context, operands);
+    loopID->replaceOperandWith(0, loopID);
+    return loopID;
+}
+
 void CodeGenerator::generateIfStatement(const NodeIf *node)
 {
     llvm::Function *function = builder.GetInsertBlock()->getParent();
@@ -561,19 +1752,7 @@ void CodeGenerator::generateIfStatement(const NodeIf *node)
     if (node->getElseBranch())
         elseBlock = llvm::BasicBlock::Create(context, "if.else");
     llvm::BasicBlock *mergeBlock = llvm::BasicBlock::Create(context, "if.end");
-    llvm::Value *condValue = generateExpression(node->getCondition(), builder.getInt32Ty());
-    if (!condValue)
-        ERROR(node->getLine(), "Invalid if condition");
-
-    llvm::Value *condBool = builder.CreateICmpNE(
-        condValue,
-        llvm::ConstantInt::get(builder.getInt32Ty(), 0),
-        "ifcond");
-
-    if (node->getElseBranch())
-        builder.CreateCondBr(condBool, thenBlock, elseBlock);
-    else
-        builder.CreateCondBr(condBool, thenBlock, mergeBlock);
+    emitConditionalBranch(node->getCondition(), thenBlock, elseBlock ? elseBlock : mergeBlock, node->getHint());
 
     builder.SetInsertPoint(thenBlock);
     symbolTable.enterScope();
@@ -616,8 +1795,114 @@ void CodeGenerator::generateIfStatement(const NodeIf *node)
     builder.SetInsertPoint(mergeBlock);
 }
 
+void CodeGenerator::generateMatchStatement(const NodeMatch *node)
+{
+    // Ranges up to this many values become individual switch cases; wider ones are
+    // tested with a subtract and unsigned compare once the switch falls through.
+    constexpr uint64_t maxExpandedRange = 64;
+
+    llvm::Type *subjectType = inferExpressionType(node->getSubject());
+    if (!subjectType)
+        subjectType = builder.getInt32Ty();
+    auto *intType = llvm::dyn_cast<llvm::IntegerType>(subjectType);
+    if (!intType)
+        ERROR(node->getLine(), "Match subject must be an integer");
+
+    llvm::Value *subject = generateCastExpression(node->getSubject(), intType);
+
+    llvm::Function *function = builder.GetInsertBlock()->getParent();
+    const auto &arms = node->getArms();
+    llvm::BasicBlock *endBlock = llvm::BasicBlock::Create(context, "match.end");
+    llvm::BasicBlock *defaultBlock = endBlock;
+
+    std::vector<llvm::BasicBlock *> armBlocks;
+    for (size_t i = 0; i < arms.size(); i++)
+    {
+        armBlocks.push_back(llvm::BasicBlock::Create(context, "match.arm", function));
+        if (!arms[i].isDefault)
+            continue;
+        if (i + 1 != arms.size())
+            ERROR(arms[i + 1].line, "Match arms after '_' are unreachable");
+        defaultBlock = armBlocks.back();
+    }
+
+    llvm::SwitchInst *switchInst = builder.CreateSwitch(subject, defaultBlock);
+    const unsigned bits = intType->getBitWidth();
+    std::unordered_set<int64_t> claimed;
+    std::vector<std::pair<MatchPattern, llvm::BasicBlock *>> wideRanges;
+
+    for (size_t i = 0; i < arms.size(); i++)
+    {
+        for (const auto &pattern : arms[i].patterns)
+        {
+            if (!llvm::isIntN(bits, pattern.low) || !llvm::isIntN(bits, pattern.high))
+                ERROR(arms[i].line, "Match pattern does not fit in the %u-bit subject", bits);
+
+            // The span is computed unsigned so ranges reaching the ends of i64 cannot overflow.
+            const uint64_t span = static_cast<uint64_t>(pattern.high) - static_cast<uint64_t>(pattern.low);
+            if (span >= maxExpandedRange)
+            {
+                wideRanges.push_back({pattern, armBlocks[i]});
+                continue;
+            }
+
+            // Earlier arms win, so values already taken by a case or a wide range are skipped.
+            for (uint64_t step = 0; step <= span; step++)
+            {
+                const int64_t value = static_cast<int64_t>(static_cast<uint64_t>(pattern.low) + step);
+                bool covered = false;
+                for (const auto &range : wideRanges)
+                    covered |= value >= range.first.low && value <= range.first.high;
+                if (!covered && claimed.insert(value).second)
+                    switchInst->addCase(llvm::ConstantInt::get(intType, value, true), armBlocks[i]);
+            }
+        }
+    }
+
+    if (!wideRanges.empty())
+    {
+        llvm::BasicBlock *checkBlock = llvm::BasicBlock::Create(context, "match.range", function);
+        switchInst->setDefaultDest(checkBlock);
+        for (size_t i = 0; i < wideRanges.size(); i++)
+        {
+            const MatchPattern &range = wideRanges[i].first;
+            builder.SetInsertPoint(checkBlock);
+            llvm::Value *offset = builder.CreateSub(subject, llvm::ConstantInt::get(intType, range.low, true), "match.offset");
+            llvm::Value *inRange = builder.CreateICmpULE(offset, llvm::ConstantInt::get(intType, static_cast<uint64_t>(range.high) - static_cast<uint64_t>(range.low)), "match.inrange");
+
+            checkBlock = i + 1 < wideRanges.size() ? llvm::BasicBlock::Create(context, "match.range", function) : defaultBlock;
+            builder.CreateCondBr(inRange, wideRanges[i].second, checkBlock);
+        }
+    }
+
+    for (size_t i = 0; i < arms.size(); i++)
+    {
+        builder.SetInsertPoint(armBlocks[i]);
+        symbolTable.enterScope();
+        if (auto bodyNode = dynamic_cast<const NodeBlock *>(arms[i].body.get()))
+        {
+            for (const auto &stmt : bodyNode->getStatements())
+                generateStatement(stmt.get());
+        }
+        else
+            generateStatement(arms[i].body.get());
+        symbolTable.exitScope();
+
+        if (!builder.GetInsertBlock()->getTerminator())
+            builder.CreateBr(endBlock);
+    }
+
+    function->insert(function->end(), endBlock);
+    builder.SetInsertPoint(endBlock);
+}
+
 void CodeGenerator::generateReturn(const NodeReturn *node)
 {
+    if (coroutine.handle)
+        return generateAsyncReturn(node);
+    if (node->isTailCall())
+        return generateTailCall(node);
+
     hasReturn = true;
     llvm::Type *expectedType = currentFunction->getReturnType();
     if (node->getExpression())
@@ -646,19 +1931,154 @@ void CodeGenerator::generateReturn(const NodeReturn *node)
     }
 }
 
+// True when value is, or is a slice built from, a pointer into the current stack frame.
+static bool pointsIntoFrame(llvm::Value *value)
+{
+    if (auto *insert = llvm::dyn_cast<llvm::InsertValueInst>(value))
+        return pointsIntoFrame(insert->getAggregateOperand()) || pointsIntoFrame(insert->getInsertedValueOperand());
+    return value->getType()->isPointerTy() && llvm::isa<llvm::AllocaInst>(llvm::getUnderlyingObject(value));
+}
+
+void CodeGenerator::generateTailCall(const NodeReturn *node)
+{
+    hasReturn = true;
+    auto call = static_cast<const NodeFunctionCall *>(node->getExpression());
+    llvm::Function *callee = module->getFunction(call->getName());
+    if (!callee)
+        ERROR(call->getLine(), "Undefined function '%s'", call->getName().c_str());
+
+    // musttail requires the caller's frame to be reusable as is: same prototype,
+    // same calling convention, and no arguments that point into the frame being replaced.
+    const std::string callerName = currentFunction->getName().str();
+    if (callee->getFunctionType() != currentFunction->getFunctionType())
+        ERROR(node->getLine(), "Tail call to '%s' needs the same parameter and return types as '%s'", call->getName().c_str(), callerName.c_str());
+    if (callee->getCallingConv() != currentFunction->getCallingConv())
+        ERROR(node->getLine(), "Tail call to '%s' needs the same calling convention as '%s'", call->getName().c_str(), callerName.c_str());
+
+    auto *callInst = llvm::cast<llvm::CallInst>(handleFunctionCall(call, currentFunction->getReturnType()));
+    for (llvm::Value *arg : callInst->args())
+    {
+        if (pointsIntoFrame(arg))
+            ERROR(node->getLine(), "Tail call to '%s' cannot pass the address of a local variable", call->getName().c_str());
+    }
+
+    callInst->removeFnAttr(llvm::Attribute::AlwaysInline);
+    callInst->setCallingConv(callee->getCallingConv());
+    callInst->setTailCallKind(llvm::CallInst::TCK_MustTail);
+
+    if (callInst->getType()->isVoidTy())
+        builder.CreateRetVoid();
+    else
+        builder.CreateRet(callInst);
+}
+
+bool CodeGenerator::isSliceType(llvm::Type *type) const
+{
+    auto *structType = llvm::dyn_cast_or_null<llvm::StructType>(type);
+    return structType && structType->isLiteral() && structType->getNumElements() == 2 &&
+           structType->getElementType(0)->isPointerTy() && structType->getElementType(1)->isIntegerTy(64);
+}
+
+llvm::Value *CodeGenerator::makeSlice(llvm::Type *sliceType, llvm::Value *data, llvm::Value *length)
+{
+    llvm::Value *slice = llvm::UndefValue::get(sliceType);
+    slice = builder.CreateInsertValue(slice, data, 0);
+    return builder.CreateInsertValue(slice, castValue(length, builder.getInt64Ty()), 1, "slice");
+}
+
+llvm::Value *CodeGenerator::getArrayLength(const SymbolTable::Symbol *sym)
+{
+    if (sym->type->isArrayTy())
+        return builder.getInt64(sym->type->getArrayNumElements());
+    if (isSliceType(sym->type))
+        return builder.CreateExtractValue(loadVariable(sym, "slice"), 1, "slice.len");
+    return nullptr;
+}
+
+void CodeGenerator::emitBoundsCheck(llvm::Value *index, llvm::Value *length, llvm::Value *guard)
+{
+    llvm::Function *function = builder.GetInsertBlock()->getParent();
+    if (!boundsFailBlock || boundsFailBlock->getParent() != function)
+    {
+        boundsFailBlock = llvm::BasicBlock::Create(context, "bounds.fail", function);
+        llvm::IRBuilder<> failBuilder(boundsFailBlock);
+        failBuilder.CreateCall(llvm::Intrinsic::getDeclaration(module.get(), llvm::Intrinsic::trap));
+        failBuilder.CreateUnreachable();
+    }
+
+    // Negative indices wrap to huge unsigned values, so one unsigned compare covers both ends.
+    llvm::BasicBlock *okBlock = llvm::BasicBlock::Create(context, "bounds.ok", function);
+    llvm::Value *inBounds = builder.CreateICmpULT(index, length, "inbounds");
+    if (guard)
+        inBounds = builder.CreateOr(guard, inBounds, "inbounds.guarded");
+    builder.CreateCondBr(inBounds, okBlock, boundsFailBlock, llvm::MDBuilder(context).createBranchWeights(2000, 1));
+    builder.SetInsertPoint(okBlock);
+}
+
+// Generates node converted to exactly type; castValue leaves values it cannot
+// convert unchanged, so those are reported here instead of reaching the IR.
+llvm::Value *CodeGenerator::generateCastExpression(const Node *node, llvm::Type *type)
+{
+    llvm::Value *value = generateExpression(node, type);
+    if (!value)
+        ERROR(node->getLine(), "Expression does not produce a value");
+
+    value = castValue(value, type);
+    if (value->getType() != type)
+    {
+        std::string expectedStr, actualStr;
+        llvm::raw_string_ostream rsoExpected(expectedStr);
+        llvm::raw_string_ostream rsoActual(actualStr);
+        type->print(rsoExpected);
+        value->getType()->print(rsoActual);
+        ERROR(node->getLine(), "Type mismatch: expected '%s' but got '%s'", rsoExpected.str().c_str(), rsoActual.str().c_str());
+    }
+    return value;
+}
+
 llvm::Value *CodeGenerator::castValue(llvm::Value *value, llvm::Type *expectedType)
 {
-    if (value->getType() == expectedType)
+    if (!expectedType || value->getType() == expectedType)
         return value;
-    if (value->getType()->isIntegerTy() && expectedType->isIntegerTy())
+
+    llvm::Type *srcType = value->getType();
+    if (auto *vectorType = llvm::dyn_cast<llvm::FixedVectorType>(expectedType))
+    {
+        if (!srcType->isVectorTy())
+        {
+            llvm::Value *element = castValue(value, vectorType->getElementType());
+            return builder.CreateVectorSplat(vectorType->getNumElements(), element, "splat");
+        }
+        if (llvm::cast<llvm::FixedVectorType>(srcType)->getNumElements() != vectorType->getNumElements())
+            return value;
+    }
+    else if (srcType->isVectorTy())
+        return value;
+
+    if (srcType->isIntOrIntVectorTy() && expectedType->isIntOrIntVectorTy())
     {
-        unsigned srcBits = value->getType()->getIntegerBitWidth();
-        unsigned dstBits = expectedType->getIntegerBitWidth();
+        unsigned srcBits = srcType->getScalarSizeInBits();
+        unsigned dstBits = expectedType->getScalarSizeInBits();
+        // Bools widen to 0 or 1, and any non-zero integer narrows to true.
+        if (srcBits == 1)
+            return builder.CreateZExt(value, expectedType, "zext");
+        if (dstBits == 1)
+            return builder.CreateICmpNE(value, llvm::Constant::getNullValue(srcType), "tobool");
         if (srcBits < dstBits)
             return builder.CreateSExt(value, expectedType, "sext");
         else if (srcBits > dstBits)
             return builder.CreateTrunc(value, expectedType, "trunc");
     }
+    else if (srcType->isIntOrIntVectorTy(1) && expectedType->isFPOrFPVectorTy())
+        return builder.CreateUIToFP(value, expectedType, "uitofp");
+    else if (srcType->isIntOrIntVectorTy() && expectedType->isFPOrFPVectorTy())
+        return builder.CreateSIToFP(value, expectedType, "sitofp");
+    else if (srcType->isFPOrFPVectorTy() && expectedType->isIntOrIntVectorTy(1))
+        return builder.CreateFCmpUNE(value, llvm::Constant::getNullValue(srcType), "tobool");
+    else if (srcType->isFPOrFPVectorTy() && expectedType->isIntOrIntVectorTy())
+        return builder.CreateFPToSI(value, expectedType, "fptosi");
+    else if (srcType->isFPOrFPVectorTy() && expectedType->isFPOrFPVectorTy())
+        return builder.CreateFPCast(value, expectedType, "fpcast");
 
     return value;
 }
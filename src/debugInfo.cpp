@@ -0,0 +1,187 @@
+#include "../include/codegen.hpp"
+#include "llvm/BinaryFormat/Dwarf.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include <optional>
+
+// DWARF for -g and -gline-tables-only. Every function gets a subprogram and every
+// statement a line location, which is all a sampling profiler needs to attribute
+// samples to source lines. At -g locals are described too: variables in memory
+// through dbg.declare, SSA-promoted ones through a dbg.value at each assignment and
+// at each phi where control flow merges, so they can still be shown after -O3 has
+// rewritten the code around them. Everything is scoped to its function; nested
+// blocks do not get lexical scopes of their own. --remarks without -g builds the
+// same locations in a NoDebug unit, so remarks have lines but the object has no DWARF.
+
+void CodeGenerator::enableDebugInfo(DebugLevel level, const std::string &sourcePath, bool optimized)
+{
+    if (level == DebugLevel::None)
+        return;
+
+    llvm::SmallString<256> path(sourcePath);
+    llvm::sys::fs::make_absolute(path);
+    debugBuilder = std::make_unique<llvm::DIBuilder>(*module);
+    debugFile = debugBuilder->createFile(llvm::sys::path::filename(path), llvm::sys::path::parent_path(path));
+    const llvm::DICompileUnit::DebugEmissionKind kind = level == DebugLevel::Full         ? llvm::DICompileUnit::FullDebug
+                                                        : level == DebugLevel::LineTables ? llvm::DICompileUnit::LineTablesOnly
+                                                                                          : llvm::DICompileUnit::NoDebug;
+    debugUnit = debugBuilder->createCompileUnit(llvm::dwarf::DW_LANG_C, debugFile, "tvyscc", optimized, "", 0, "", kind);
+    debugVariables = level == DebugLevel::Full;
+
+    module->addModuleFlag(llvm::Module::Warning, "Debug Info Version", llvm::DEBUG_METADATA_VERSION);
+    module->addModuleFlag(llvm::Module::Max, "Dwarf Version", 5);
+}
+
+void CodeGenerator::finalizeDebugInfo()
+{
+    if (debugBuilder)
+        debugBuilder->finalize();
+}
+
+llvm::DIType *CodeGenerator::getDebugType(const std::string &typeName)
+{
+    if (typeName.rfind("restrict ", 0) == 0)
+        return getDebugType(typeName.substr(9));
+
+    auto cached = debugTypes.find(typeName);
+    if (cached != debugTypes.end())
+        return cached->second;
+
+    const llvm::DataLayout &layout = module->getDataLayout();
+    const uint64_t pointerBits = layout.getPointerSizeInBits();
+    llvm::Type *type = getLLVMType(typeName);
+    llvm::DIType *debugType = nullptr;
+
+    if (typeName.rfind("[]", 0) == 0)
+    {
+        // A slice is shown as the struct it is: a pointer to the elements and a length.
+        llvm::DIType *element = getDebugType(typeName.substr(2));
+        llvm::Metadata *members[] = {
+            debugBuilder->createMemberType(debugUnit, "ptr", debugFile, 0, pointerBits, 0, 0, llvm::DINode::FlagZero,
+                                           debugBuilder->createPointerType(element, pointerBits)),
+            debugBuilder->createMemberType(debugUnit, "len", debugFile, 0, 64, 0, pointerBits, llvm::DINode::FlagZero,
+                                           getDebugType("i64"))};
+        debugType = debugBuilder->createStructType(debugUnit, typeName, debugFile, 0, layout.getTypeSizeInBits(type), 0,
+                                                   llvm::DINode::FlagZero, nullptr, debugBuilder->getOrCreateArray(members));
+    }
+    else if (typeName.back() == '*')
+        debugType = debugBuilder->createPointerType(getDebugType(typeName.substr(0, typeName.size() - 1)), pointerBits);
+    else if (type && type->isArrayTy())
+    {
+        std::vector<llvm::Metadata *> subscripts;
+        llvm::Type *element = type;
+        for (; element->isArrayTy(); element = element->getArrayElementType())
+            subscripts.push_back(debugBuilder->getOrCreateSubrange(0, static_cast<int64_t>(element->getArrayNumElements())));
+        debugType = debugBuilder->createArrayType(layout.getTypeSizeInBits(type), layout.getABITypeAlign(type).value() * 8,
+                                                  getDebugType(typeName.substr(0, typeName.find('['))),
+                                                  debugBuilder->getOrCreateArray(subscripts));
+    }
+    else if (auto *vectorType = llvm::dyn_cast_or_null<llvm::FixedVectorType>(type))
+    {
+        llvm::Metadata *subscripts[] = {debugBuilder->getOrCreateSubrange(0, static_cast<int64_t>(vectorType->getNumElements()))};
+        debugType = debugBuilder->createVectorType(layout.getTypeSizeInBits(type), layout.getABITypeAlign(type).value() * 8,
+                                                   getDebugType(typeName.substr(0, typeName.find('x'))),
+                                                   debugBuilder->getOrCreateArray(subscripts));
+    }
+    else if (type && type->isStructTy())
+        debugType = debugBuilder->createStructType(debugUnit, typeName, debugFile, 0, layout.getTypeSizeInBits(type), 0,
+                                                   llvm::DINode::FlagZero, nullptr, llvm::DINodeArray());
+    else if (type && type->isPointerTy())
+        debugType = debugBuilder->createPointerType(nullptr, pointerBits, 0, std::nullopt, typeName);
+    else if (type && type->isIntegerTy(1))
+        debugType = debugBuilder->createBasicType(typeName, 8, llvm::dwarf::DW_ATE_boolean);
+    else if (type && type->isIntegerTy())
+        debugType = debugBuilder->createBasicType(typeName, type->getIntegerBitWidth(), llvm::dwarf::DW_ATE_signed);
+    else if (type && type->isFloatingPointTy())
+        debugType = debugBuilder->createBasicType(typeName, type->getPrimitiveSizeInBits(), llvm::dwarf::DW_ATE_float);
+
+    debugTypes[typeName] = debugType;
+    return debugType;
+}
+
+void CodeGenerator::beginDebugFunction(llvm::Function *function, const NodeFunctionDeclaration *node, int line)
+{
+    if (!debugBuilder)
+        return;
+
+    // Line tables need no types, and an outlined body has no declaration to take them from.
+    std::vector<llvm::Metadata *> types;
+    if (debugVariables && node)
+    {
+        types.push_back(getDebugType(node->getReturnType()));
+        for (const auto &arg : node->getArgs())
+            types.push_back(getDebugType(arg.second));
+    }
+    llvm::DISubroutineType *type = debugBuilder->createSubroutineType(debugBuilder->getOrCreateTypeArray(types));
+
+    llvm::DISubprogram::DISPFlags flags = llvm::DISubprogram::SPFlagDefinition;
+    if (debugUnit->isOptimized())
+        flags |= llvm::DISubprogram::SPFlagOptimized;
+    if (function->hasLocalLinkage())
+        flags |= llvm::DISubprogram::SPFlagLocalToUnit;
+    debugScope = debugBuilder->createFunction(debugFile, function->getName(), function->getName(), debugFile, line, type, line,
+                                              node ? llvm::DINode::FlagPrototyped : llvm::DINode::FlagArtificial, flags);
+    function->setSubprogram(debugScope);
+    setDebugLocation(line);
+}
+
+void CodeGenerator::finishDebugFunction()
+{
+    if (!debugScope)
+        return;
+
+    // A variable's value at a merge point is the phi built for it there.
+    for (const auto &[handle, variable] : debugPhis)
+    {
+        auto *phi = llvm::dyn_cast_or_null<llvm::PHINode>(static_cast<llvm::Value *>(handle));
+        if (!phi || phi->getParent()->getFirstInsertionPt() == phi->getParent()->end())
+            continue;
+        const llvm::DILocation *location = llvm::DILocation::get(context, variable->getLine(), 0, debugScope);
+        debugBuilder->insertDbgValueIntrinsic(phi, variable, debugBuilder->createExpression(), location, &*phi->getParent()->getFirstInsertionPt());
+    }
+    debugPhis.clear();
+
+    debugBuilder->finalizeSubprogram(debugScope);
+    debugScope = nullptr;
+    builder.SetCurrentDebugLocation(llvm::DebugLoc());
+}
+
+void CodeGenerator::setDebugLocation(int line)
+{
+    if (debugScope)
+        builder.SetCurrentDebugLocation(llvm::DILocation::get(context, line, 0, debugScope));
+}
+
+llvm::DILocalVariable *CodeGenerator::createDebugVariable(const std::string &name, const std::string &type, int line, unsigned argNo)
+{
+    if (!debugVariables || !debugScope)
+        return nullptr;
+    llvm::DIType *debugType = getDebugType(type);
+    if (argNo)
+        return debugBuilder->createParameterVariable(debugScope, name, argNo, debugFile, line, debugType);
+    return debugBuilder->createAutoVariable(debugScope, name, debugFile, line, debugType);
+}
+
+void CodeGenerator::emitDebugDeclare(llvm::DILocalVariable *variable, llvm::Value *storage)
+{
+    if (!variable)
+        return;
+    const llvm::DILocation *location = llvm::DILocation::get(context, variable->getLine(), 0, debugScope);
+    debugBuilder->insertDeclare(storage, variable, debugBuilder->createExpression(), location, builder.GetInsertBlock());
+}
+
+void CodeGenerator::emitDebugValue(llvm::DILocalVariable *variable, llvm::Value *value)
+{
+    if (!variable || builder.GetInsertBlock()->getTerminator())
+        return;
+    debugBuilder->insertDbgValueIntrinsic(value, variable, debugBuilder->createExpression(), builder.getCurrentDebugLocation(), builder.GetInsertBlock());
+}
+
+void CodeGenerator::emitDebugGlobal(llvm::GlobalVariable *global, const std::string &name, const std::string &type, int line)
+{
+    if (!debugVariables)
+        return;
+    llvm::DIScope *scope = debugScope ? static_cast<llvm::DIScope *>(debugScope) : debugUnit;
+    global->addDebugInfo(debugBuilder->createGlobalVariableExpression(scope, name, global->getName(), debugFile, line,
+                                                                      getDebugType(type), global->hasLocalLinkage()));
+}
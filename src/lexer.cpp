@@ -7,16 +7,34 @@ const std::unordered_map<std::string, Token::Kind> Lexer::keywords = {
 	{"let", Token::Kind::TOKEN_LET},
 	{"fn", Token::Kind::TOKEN_FN},
 	{"while", Token::Kind::TOKEN_WHILE},
+	{"for", Token::Kind::TOKEN_FOR},
+	{"parallel", Token::Kind::TOKEN_PARALLEL},
 	{"if", Token::Kind::TOKEN_IF},
+	{"match", Token::Kind::TOKEN_MATCH},
 	{"else", Token::Kind::TOKEN_ELSE},
 	{"return", Token::Kind::TOKEN_RETURN},
+	{"become", Token::Kind::TOKEN_BECOME},
+	{"async", Token::Kind::TOKEN_ASYNC},
+	{"await", Token::Kind::TOKEN_AWAIT},
 	{"ref", Token::Kind::TOKEN_REF},
+	{"restrict", Token::Kind::TOKEN_RESTRICT},
+	{"static", Token::Kind::TOKEN_STATIC},
+	{"const", Token::Kind::TOKEN_CONST},
+	{"thread_local", Token::Kind::TOKEN_THREAD_LOCAL},
+	{"true", Token::Kind::TOKEN_TRUE},
+	{"false", Token::Kind::TOKEN_FALSE},
+	{"bool", Token::Kind::TOKEN_INT_TYPE},
 	{"ext", Token::Kind::TOKEN_EXTERN},
 	{"i8", Token::Kind::TOKEN_INT_TYPE},
 	{"i16", Token::Kind::TOKEN_INT_TYPE},
 	{"i32", Token::Kind::TOKEN_INT_TYPE},
 	{"i64", Token::Kind::TOKEN_INT_TYPE},
-	{"void", Token::Kind::TOKEN_INT_TYPE}};
+	{"f32", Token::Kind::TOKEN_INT_TYPE},
+	{"f64", Token::Kind::TOKEN_INT_TYPE},
+	{"void", Token::Kind::TOKEN_INT_TYPE},
+	{"task", Token::Kind::TOKEN_INT_TYPE},
+	{"arena", Token::Kind::TOKEN_INT_TYPE},
+	{"pool", Token::Kind::TOKEN_INT_TYPE}};
 
 const std::unordered_map<char, Token::Kind> Lexer::singleCharTokens = {
 	{'+', Token::Kind::TOKEN_PLUS},
@@ -34,6 +52,10 @@ const std::unordered_map<char, Token::Kind> Lexer::singleCharTokens = {
 	{'}', Token::Kind::TOKEN_RBRACE},
 	{'[', Token::Kind::TOKEN_LBRACKET},
 	{']', Token::Kind::TOKEN_RBRACKET},
+	{'#', Token::Kind::TOKEN_HASH},
+	{'^', Token::Kind::TOKEN_CARET},
+	{'%', Token::Kind::TOKEN_PERCENT},
+	{'|', Token::Kind::TOKEN_PIPE},
 	{'<', Token::Kind::TOKEN_LESS},
 	{'>', Token::Kind::TOKEN_GREATER}};
 
@@ -58,25 +80,46 @@ Token Lexer::nextToken()
 {
 	const char c = peek();
 
-	if (c == '=' || c == '!' || c == '<' || c == '>' || c == '-')
+	if (c == '=' || c == '!' || c == '<' || c == '>' || c == '-' || c == '&' || c == '|')
 	{
 		const size_t start = position;
 		advance();
 
 		if (c == '=' && match('='))
 			return Token(Token::Kind::TOKEN_EQUAL_EQUAL, "==", currentLine);
+		if (c == '=' && match('>'))
+			return Token(Token::Kind::TOKEN_FAT_ARROW, "=>", currentLine);
 		if (c == '!' && match('='))
 			return Token(Token::Kind::TOKEN_BANG_EQUAL, "!=", currentLine);
 		if (c == '<' && match('='))
 			return Token(Token::Kind::TOKEN_LESS_EQUAL, "<=", currentLine);
 		if (c == '>' && match('='))
 			return Token(Token::Kind::TOKEN_GREATER_EQUAL, ">=", currentLine);
+		if (c == '<' && match('<'))
+			return Token(Token::Kind::TOKEN_SHL, "<<", currentLine);
+		if (c == '>' && match('>'))
+			return Token(Token::Kind::TOKEN_SHR, ">>", currentLine);
 		if (c == '-' && match('>'))
 			return Token(Token::Kind::TOKEN_ARROW, "->", currentLine);
+		if (c == '&' && match('&'))
+			return Token(Token::Kind::TOKEN_AND_AND, "&&", currentLine);
+		if (c == '|' && match('|'))
+			return Token(Token::Kind::TOKEN_PIPE_PIPE, "||", currentLine);
+		if (c == '!')
+			return Token(Token::Kind::TOKEN_BANG, "!", currentLine);
 
 		position = start;
 	}
 
+	if (c == '.' && position + 1 < source.size() && source[position + 1] == '.')
+	{
+		advance();
+		advance();
+		if (match('='))
+			return Token(Token::Kind::TOKEN_DOT_DOT_EQUAL, "..=", currentLine);
+		return Token(Token::Kind::TOKEN_DOT_DOT, "..", currentLine);
+	}
+
 	if (auto it = singleCharTokens.find(c); it != singleCharTokens.end())
 	{
 		advance();
@@ -86,6 +129,9 @@ Token Lexer::nextToken()
 	if (isalpha(c) || c == '_')
 		return identifierOrKeyword();
 
+	if (c == '@')
+		return builtinName();
+
 	if (isdigit(c))
 		return numberLiteral();
 
@@ -109,14 +155,40 @@ Token Lexer::identifierOrKeyword()
 		return Token(it->second, value, currentLine);
 	}
 
+	if (isVectorTypeName(value))
+		return Token(Token::Kind::TOKEN_INT_TYPE, value, currentLine);
+
 	return Token(Token::Kind::TOKEN_IDENTIFIER, value, currentLine);
 }
 
+Token Lexer::builtinName()
+{
+	advance();
+	const size_t start = position;
+	while (position < source.size() && isIdentifierChar(peek()))
+		advance();
+
+	if (position == start)
+		ERROR(currentLine, "Expected builtin name after '@'");
+
+	return Token(Token::Kind::TOKEN_BUILTIN, source.substr(start, position - start), currentLine);
+}
+
 Token Lexer::numberLiteral()
 {
 	const size_t start = position;
 	bool hasDecimal = false;
 
+	if (peek() == '0' && position + 2 < source.size() && (source[position + 1] == 'x' || source[position + 1] == 'X') &&
+		isxdigit(source[position + 2]))
+	{
+		advance();
+		advance();
+		while (position < source.size() && isxdigit(peek()))
+			advance();
+		return Token(Token::Kind::TOKEN_NUMBER, source.substr(start, position - start), currentLine);
+	}
+
 	while (position < source.size())
 	{
 		const char c = peek();
@@ -124,7 +196,7 @@ Token Lexer::numberLiteral()
 		{
 			advance();
 		}
-		else if (c == '.' && !hasDecimal)
+		else if (c == '.' && !hasDecimal && position + 1 < source.size() && isdigit(source[position + 1]))
 		{
 			hasDecimal = true;
 			advance();
@@ -233,4 +305,25 @@ bool Lexer::match(char expected)
 bool Lexer::isIdentifierChar(char c) const
 {
 	return isalnum(c) || c == '_';
+}
+
+bool Lexer::isVectorTypeName(const std::string &name)
+{
+	static const char *const scalarTypes[] = {"i8", "i16", "i32", "i64", "f32", "f64"};
+
+	for (const char *scalar : scalarTypes)
+	{
+		const std::string prefix = std::string(scalar) + "x";
+		if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0)
+			continue;
+
+		for (size_t i = prefix.size(); i < name.size(); i++)
+		{
+			if (!isdigit(name[i]))
+				return false;
+		}
+		return true;
+	}
+
+	return false;
 }
\ No newline at end of file
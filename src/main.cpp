@@ -1,6 +1,7 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <optional>
 #include "llvm/IR/PassManager.h"
 #include "llvm/Passes/PassBuilder.h"
 #include "llvm/Passes/PassPlugin.h"
@@ -10,6 +11,13 @@
 #include "llvm/TargetParser/Host.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Transforms/Utils/ModuleUtils.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/DiagnosticHandler.h"
+#include "llvm/IR/LLVMRemarkStreamer.h"
+#include "llvm/Support/Regex.h"
+#include "llvm/Support/ToolOutputFile.h"
 #include "../include/lexer.hpp"
 #include "../include/parser.hpp"
 #include "../include/codegen.hpp"
@@ -30,16 +38,189 @@ std::string readSourceFile(const std::string &filename)
     return buffer.str();
 }
 
+// Prints the optimization remarks selected with --remarks as "file:line:col: remark:"
+// diagnostics against the .tvys source.
+struct RemarkPrinter : llvm::DiagnosticHandler
+{
+    std::string sourcePath;
+    bool passed = false;
+    bool missed = false;
+    bool analysis = false;
+    std::optional<llvm::Regex> filter;
+
+    bool matches(llvm::StringRef pass) const { return !filter || filter->match(pass); }
+    bool isPassedOptRemarkEnabled(llvm::StringRef pass) const override { return passed && matches(pass); }
+    bool isMissedOptRemarkEnabled(llvm::StringRef pass) const override { return missed && matches(pass); }
+    bool isAnalysisRemarkEnabled(llvm::StringRef pass) const override { return analysis && matches(pass); }
+    // The default asks about the empty pass name, which a filter may reject.
+    bool isAnyRemarkEnabled() const override { return passed || missed || analysis; }
+
+    bool handleDiagnostics(const llvm::DiagnosticInfo &info) override
+    {
+        auto *remark = llvm::dyn_cast<llvm::DiagnosticInfoOptimizationBase>(&info);
+        if (!remark)
+            return false;
+
+        const llvm::StringRef pass = remark->getPassName();
+        const char *kind = remark->isPassed() ? "passed" : remark->isMissed() ? "missed" : "analysis";
+        if (!(remark->isPassed() ? isPassedOptRemarkEnabled(pass) : remark->isMissed() ? isMissedOptRemarkEnabled(pass)
+                                                                                      : isAnalysisRemarkEnabled(pass)))
+            return true;
+
+        llvm::errs() << sourcePath;
+        if (auto *located = llvm::dyn_cast<llvm::DiagnosticInfoWithLocationBase>(remark); located && located->isLocationAvailable())
+        {
+            const llvm::DiagnosticLocation location = located->getLocation();
+            llvm::errs() << ":" << location.getLine();
+            if (location.getColumn())
+                llvm::errs() << ":" << location.getColumn();
+        }
+        llvm::errs() << ": remark: " << remark->getMsg() << " [" << kind << " " << pass << "]\n";
+        return true;
+    }
+};
+
+void printUsage(const char *program)
+{
+    std::cerr << "Usage: " << program << " <input-file> <output-file> [options]" << std::endl;
+    std::cerr << "Options:" << std::endl;
+    std::cerr << "  -mcpu=<cpu>      Target CPU to optimize for ('native' uses the host CPU and its features)" << std::endl;
+    std::cerr << "  -O<level>        Optimization level 0-3 (default 3); -O0 skips the optimizer" << std::endl;
+    std::cerr << "  --bounds-checks  Trap on out-of-range array and slice indexing" << std::endl;
+    std::cerr << "  --emit-llvm      Print the final LLVM IR to stdout" << std::endl;
+    std::cerr << "  -g               Emit DWARF debug info: line tables, functions, types and local variables" << std::endl;
+    std::cerr << "  -gline-tables-only  Emit only the DWARF line tables, enough for profilers to attribute samples" << std::endl;
+    std::cerr << "  --freestanding   Assume no C library: no runtime, weak memcpy/memmove/memset, serial parallel for" << std::endl;
+    std::cerr << "  --reloc=<model>  Relocation model: pic (default), static or dynamic-no-pic" << std::endl;
+    std::cerr << "  --code-model=<m> Code model: tiny, small, kernel, medium or large" << std::endl;
+    std::cerr << "  --no-red-zone    Do not use the stack red zone (needed in kernels that take interrupts)" << std::endl;
+    std::cerr << "  --entry=<sym>    Entry function; placed first in .text.entry and kept by the linker" << std::endl;
+    std::cerr << "  --remarks=<kinds>  Print optimization remarks: passed, missed and/or analysis, comma-separated" << std::endl;
+    std::cerr << "  --remarks-filter=<regex>  Only remarks from passes matching regex (e.g. 'loop-vectorize|inline|licm')" << std::endl;
+    std::cerr << "  --remarks-file=<path>  Write remarks of every kind from matching passes as YAML" << std::endl;
+    std::cerr << "  --instrument-functions=xray  Emit patchable entry/exit sleds; run with TVYS_PROFILE=1 for a per-function profile" << std::endl;
+}
+
 int main(int argc, char *argv[])
 {
-    if (argc < 3)
+    std::string inputFilename;
+    std::string outputFilename;
+    std::string cpu = "generic";
+    std::string features;
+    bool boundsChecks = false;
+    bool emitLLVM = false;
+    bool freestanding = false;
+    CodeGenerator::DebugLevel debugLevel = CodeGenerator::DebugLevel::None;
+    bool noRedZone = false;
+    bool instrumentFunctions = false;
+    auto remarks = std::make_unique<RemarkPrinter>();
+    std::string remarksFilter;
+    std::string remarksFile;
+    std::string entry;
+    llvm::Reloc::Model relocModel = llvm::Reloc::PIC_;
+    std::optional<llvm::CodeModel::Model> codeModel;
+    int optLevel = 3;
+
+    const std::unordered_map<std::string, llvm::Reloc::Model> relocModels = {
+        {"pic", llvm::Reloc::PIC_}, {"static", llvm::Reloc::Static}, {"dynamic-no-pic", llvm::Reloc::DynamicNoPIC}};
+    const std::unordered_map<std::string, llvm::CodeModel::Model> codeModels = {
+        {"tiny", llvm::CodeModel::Tiny}, {"small", llvm::CodeModel::Small}, {"kernel", llvm::CodeModel::Kernel},
+        {"medium", llvm::CodeModel::Medium}, {"large", llvm::CodeModel::Large}};
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg.rfind("-mcpu=", 0) == 0)
+            cpu = arg.substr(6);
+        else if (arg.size() == 3 && arg.rfind("-O", 0) == 0 && arg[2] >= '0' && arg[2] <= '3')
+            optLevel = arg[2] - '0';
+        else if (arg == "--bounds-checks")
+            boundsChecks = true;
+        else if (arg == "--emit-llvm")
+            emitLLVM = true;
+        else if (arg == "-g")
+            debugLevel = CodeGenerator::DebugLevel::Full;
+        else if (arg == "-gline-tables-only")
+            debugLevel = CodeGenerator::DebugLevel::LineTables;
+        else if (arg == "--freestanding")
+            freestanding = true;
+        else if (arg == "--no-red-zone")
+            noRedZone = true;
+        else if (arg.rfind("--remarks=", 0) == 0)
+        {
+            std::stringstream kinds(arg.substr(10));
+            std::string kind;
+            while (std::getline(kinds, kind, ','))
+            {
+                if (kind == "passed")
+                    remarks->passed = true;
+                else if (kind == "missed")
+                    remarks->missed = true;
+                else if (kind == "analysis")
+                    remarks->analysis = true;
+                else
+                {
+                    std::cerr << "Unknown remark kind '" << kind << "'" << std::endl;
+                    return 1;
+                }
+            }
+        }
+        else if (arg.rfind("--remarks-filter=", 0) == 0)
+            remarksFilter = arg.substr(17);
+        else if (arg.rfind("--remarks-file=", 0) == 0 && arg.size() > 15)
+            remarksFile = arg.substr(15);
+        else if (arg == "--instrument-functions=xray")
+            instrumentFunctions = true;
+        else if (arg.rfind("--entry=", 0) == 0 && arg.size() > 8)
+            entry = arg.substr(8);
+        else if (arg.rfind("--reloc=", 0) == 0 && relocModels.count(arg.substr(8)))
+            relocModel = relocModels.at(arg.substr(8));
+        else if (arg.rfind("--code-model=", 0) == 0 && codeModels.count(arg.substr(13)))
+            codeModel = codeModels.at(arg.substr(13));
+        else if (!arg.empty() && arg[0] == '-')
+        {
+            std::cerr << "Unknown option '" << arg << "'" << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+        else if (inputFilename.empty())
+            inputFilename = arg;
+        else if (outputFilename.empty())
+            outputFilename = arg;
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (inputFilename.empty() || outputFilename.empty())
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (!remarksFilter.empty())
+    {
+        std::string regexError;
+        remarks->filter.emplace(remarksFilter);
+        if (!remarks->filter->isValid(regexError))
+        {
+            std::cerr << "Invalid --remarks-filter '" << remarksFilter << "': " << regexError << std::endl;
+            return 1;
+        }
+    }
+    if (instrumentFunctions && freestanding)
     {
-        std::cerr << "Usage: " << argv[0] << " <input-file> <output-file>" << std::endl;
+        std::cerr << "--instrument-functions needs libtvysrt and cannot be used with --freestanding" << std::endl;
         return 1;
     }
 
-    std::string inputFilename = argv[1];
-    std::string outputFilename = argv[2];
+    if (cpu == "native")
+    {
+        cpu = llvm::sys::getHostCPUName().str();
+        for (const auto &feature : llvm::sys::getHostCPUFeatures())
+            features += (features.empty() ? "" : ",") + std::string(feature.second ? "+" : "-") + feature.first().str();
+    }
 
     std::string sourceCode = readSourceFile(inputFilename);
 
@@ -49,10 +230,6 @@ int main(int argc, char *argv[])
     Parser parser(tokens);
     std::unique_ptr<Node> ast = parser.parse();
 
-    CodeGenerator codegen("main_module");
-//    codegen.generateRuntime();
-    codegen.generate(ast.get());
-
     llvm::InitializeAllTargetInfos();
     llvm::InitializeAllTargets();
     llvm::InitializeAllTargetMCs();
@@ -70,28 +247,93 @@ int main(int argc, char *argv[])
     }
 
     llvm::TargetOptions opt;
-    auto targetMachine = target->createTargetMachine(targetTriple, "generic", "", opt, llvm::Reloc::PIC_);
+    const llvm::CodeGenOptLevel codeGenLevels[] = {llvm::CodeGenOptLevel::None, llvm::CodeGenOptLevel::Less,
+                                                   llvm::CodeGenOptLevel::Default, llvm::CodeGenOptLevel::Aggressive};
+    auto targetMachine = target->createTargetMachine(targetTriple, cpu, features, opt, relocModel, codeModel, codeGenLevels[optLevel]);
 
+    CodeGenerator codegen("main_module");
+    codegen.setBoundsChecks(boundsChecks);
+    codegen.setFreestanding(freestanding);
+    // Remarks are only useful with source lines, so they bring locations along.
+    const bool wantRemarks = remarks->isAnyRemarkEnabled() || !remarksFile.empty();
+    if (wantRemarks && debugLevel == CodeGenerator::DebugLevel::None)
+        debugLevel = CodeGenerator::DebugLevel::LocationsOnly;
+    codegen.enableDebugInfo(debugLevel, inputFilename, optLevel > 0);
     auto module = codegen.getModule();
+
+    std::unique_ptr<llvm::ToolOutputFile> remarksOutput;
+    if (!remarksFile.empty())
+    {
+        auto output = llvm::setupLLVMOptimizationRemarks(module->getContext(), remarksFile, remarksFilter, "yaml", false);
+        if (!output)
+        {
+            std::cerr << "Could not open remarks file '" << remarksFile << "': " << llvm::toString(output.takeError()) << std::endl;
+            return 1;
+        }
+        remarksOutput = std::move(*output);
+    }
+    if (remarks->isAnyRemarkEnabled())
+    {
+        remarks->sourcePath = inputFilename;
+        module->getContext().setDiagnosticHandler(std::move(remarks));
+    }
     module->setDataLayout(targetMachine->createDataLayout());
     module->setTargetTriple(targetTriple);
 
-    llvm::PassBuilder passBuilder;
+    codegen.generate(ast.get());
+    if (freestanding)
+        codegen.generateFreestandingRuntime();
+    codegen.finalizeDebugInfo();
+
+    if (!entry.empty())
+    {
+        llvm::Function *entryFunction = module->getFunction(entry);
+        if (!entryFunction || entryFunction->isDeclaration())
+        {
+            std::cerr << "Entry function '" << entry << "' is not defined" << std::endl;
+            return 1;
+        }
+        // A linker script can place .text.entry first and point ENTRY() at it.
+        entryFunction->setSection(".text.entry");
+        llvm::appendToUsed(*module, {entryFunction});
+    }
+    if (noRedZone)
+    {
+        for (llvm::Function &function : *module)
+            if (!function.isDeclaration())
+                function.addFnAttr(llvm::Attribute::NoRedZone);
+    }
+    if (instrumentFunctions)
+        codegen.instrumentFunctions();
+
+    // Freestanding code cannot assume any library function exists or behaves as in libc.
+    llvm::TargetLibraryInfoImpl libraryInfo{llvm::Triple(targetTriple)};
+    if (freestanding)
+        libraryInfo.disableAllFunctions();
+
+    llvm::PassBuilder passBuilder(targetMachine);
     llvm::LoopAnalysisManager LAM;
     llvm::FunctionAnalysisManager FAM;
     llvm::CGSCCAnalysisManager CGAM;
     llvm::ModuleAnalysisManager MAM;
 
+    FAM.registerPass([&] { return llvm::TargetLibraryAnalysis(libraryInfo); });
     passBuilder.registerModuleAnalyses(MAM);
     passBuilder.registerCGSCCAnalyses(CGAM);
     passBuilder.registerFunctionAnalyses(FAM);
     passBuilder.registerLoopAnalyses(LAM);
     passBuilder.crossRegisterProxies(LAM, FAM, CGAM, MAM);
 
-    llvm::ModulePassManager modulePM = passBuilder.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O3);
+    const llvm::OptimizationLevel optLevels[] = {llvm::OptimizationLevel::O0, llvm::OptimizationLevel::O1,
+                                                 llvm::OptimizationLevel::O2, llvm::OptimizationLevel::O3};
+    llvm::ModulePassManager modulePM = optLevel == 0 ? passBuilder.buildO0DefaultPipeline(optLevels[0])
+                                                     : passBuilder.buildPerModuleDefaultPipeline(optLevels[optLevel]);
     modulePM.run(*module, MAM);
+    if (instrumentFunctions)
+        codegen.emitProfileMap();
 
-    module->print(llvm::outs(), nullptr);
+    if (emitLLVM)
+        module->print(llvm::outs(), nullptr);
 
     std::error_code ec;
     llvm::raw_fd_ostream dest(outputFilename.c_str(), ec, llvm::sys::fs::OF_None);
@@ -103,6 +345,7 @@ int main(int argc, char *argv[])
     }
 
     llvm::legacy::PassManager legacyPM;
+    legacyPM.add(new llvm::TargetLibraryInfoWrapperPass(libraryInfo));
 
     if (targetMachine->addPassesToEmitFile(legacyPM, dest, nullptr, llvm::CodeGenFileType::ObjectFile))
     {
@@ -112,6 +355,8 @@ int main(int argc, char *argv[])
 
     legacyPM.run(*module);
     dest.flush();
+    if (remarksOutput)
+        remarksOutput->keep();
 
     std::cout << "Successfully compiled '" << inputFilename << "' to object file '" << outputFilename << "'" << std::endl;
     return 0;
@@ -0,0 +1,317 @@
+#include "../include/codegen.hpp"
+#include "../include/error.hpp"
+#include "llvm/IR/MDBuilder.h"
+
+// Arena, pool and file mapping builtins. Arena and pool handles are pointers to the
+// runtime's tvys_arena and tvys_pool, whose leading fields the fast paths below
+// read and write directly: an arena allocation is an aligned bump of the cursor, a
+// pool allocation pops the free list. Only running out of room calls into the
+// runtime. Mapped files are slices over the mapping; @advise, @sync and @unmap take
+// such a slice.
+
+static llvm::StructType *getArenaType(llvm::LLVMContext &context)
+{
+    // cursor, limit, allocs
+    llvm::Type *ptr = llvm::PointerType::getUnqual(context);
+    return llvm::StructType::get(context, {ptr, ptr, llvm::Type::getInt64Ty(context)});
+}
+
+static llvm::StructType *getPoolType(llvm::LLVMContext &context)
+{
+    // free, live
+    return llvm::StructType::get(context, {llvm::PointerType::getUnqual(context), llvm::Type::getInt64Ty(context)});
+}
+
+static bool isMappingBuiltin(const std::string &name)
+{
+    return name == "map_file" || name == "map_file_rw" || name == "advise" || name == "sync" || name == "unmap";
+}
+
+// Access patterns for @advise are written as bare identifiers, e.g. @advise(data, sequential).
+static int32_t parseAdvice(const NodeBuiltinCall *call, const Node *arg)
+{
+    static const std::unordered_map<std::string, int32_t> advices = {
+        {"normal", 0}, {"sequential", 1}, {"random", 2}, {"willneed", 3}, {"dontneed", 4}};
+
+    auto id = dynamic_cast<const NodeIdentifier *>(arg);
+    auto it = id ? advices.find(id->getName()) : advices.end();
+    if (it == advices.end())
+        ERROR(call->getLine(), "Builtin '@advise' expects an access pattern (normal, sequential, random, willneed or dontneed)");
+    return it->second;
+}
+
+bool CodeGenerator::isMemoryBuiltin(const std::string &name)
+{
+    return name.rfind("arena_", 0) == 0 || name.rfind("pool_", 0) == 0 || isMappingBuiltin(name);
+}
+
+llvm::Type *CodeGenerator::inferMemoryType(const NodeBuiltinCall *call)
+{
+    const std::string &name = call->getName();
+    if (name == "arena_mark" || name == "arena_used" || name == "arena_allocs" || name == "arena_peak" || name == "pool_live")
+        return builder.getInt64Ty();
+    if (name == "arena_new" || name == "arena_alloc" || name == "pool_new" || name == "pool_alloc")
+        return builder.getPtrTy();
+    if (name == "map_file" || name == "map_file_rw")
+        return getLLVMType("[]" + (call->getTypeArgs().empty() ? std::string("i8") : call->getTypeArgs()[0]));
+    if (name == "advise" || name == "sync" || name == "unmap")
+        return builder.getInt32Ty();
+    return nullptr;
+}
+
+llvm::Value *CodeGenerator::handleMemoryBuiltin(const NodeBuiltinCall *call)
+{
+    const std::string &name = call->getName();
+    const auto &args = call->getArgs();
+    const int line = call->getLine();
+    if (!isMemoryBuiltin(name))
+        return nullptr;
+    requireHostedRuntime(line, ("'@" + name + "'").c_str());
+
+    llvm::Type *ptr = builder.getPtrTy();
+    llvm::Type *i64 = builder.getInt64Ty();
+    auto runtime = [&](const char *function, llvm::Type *result, llvm::ArrayRef<llvm::Type *> params)
+    {
+        return module->getOrInsertFunction(function, llvm::FunctionType::get(result, params, false));
+    };
+    auto handle = [&](size_t index)
+    {
+        llvm::Value *value = generateExpression(args[index].get(), ptr);
+        if (!value || !value->getType()->isPointerTy())
+            ERROR(line, "Builtin '@%s' expects a handle of type %s", name.c_str(), name[0] == 'a' ? "arena" : "pool");
+        return value;
+    };
+    auto elementType = [&]()
+    {
+        if (call->getTypeArgs().size() != 1)
+            ERROR(line, "Builtin '@%s' expects an element type, e.g. @%s<i32>", name.c_str(), name.c_str());
+        llvm::Type *type = getLLVMType(call->getTypeArgs()[0]);
+        if (!type || type->isVoidTy())
+            ERROR(line, "Unknown type: %s", call->getTypeArgs()[0].c_str());
+        return type;
+    };
+    auto expectArgs = [&](size_t min, size_t max)
+    {
+        if (args.size() < min || args.size() > max)
+        {
+            if (min == max)
+                ERROR(line, "Builtin '@%s' expects %zu arguments but got %zu", name.c_str(), min, args.size());
+            ERROR(line, "Builtin '@%s' expects %zu to %zu arguments but got %zu", name.c_str(), min, max, args.size());
+        }
+    };
+    auto readStatistic = [&](const char *function)
+    {
+        expectArgs(1, 1);
+        return builder.CreateCall(runtime(function, i64, {ptr}), {handle(0)}, name);
+    };
+
+    // The byte range of a mapped slice; its element type comes from <T> or the slice's declaration.
+    auto mappedRange = [&](llvm::Value *&data, llvm::Value *&bytes)
+    {
+        std::string typeName = call->getTypeArgs().empty() ? "" : call->getTypeArgs()[0];
+        if (typeName.empty())
+        {
+            auto id = dynamic_cast<const NodeIdentifier *>(args[0].get());
+            const SymbolTable::Symbol *sym = id ? symbolTable.lookupVariable(id->getName()) : nullptr;
+            if (!sym || sym->baseType.rfind("[]", 0) != 0)
+                ERROR(line, "Builtin '@%s' cannot tell the slice's element type; write @%s<T>(...)", name.c_str(), name.c_str());
+            typeName = sym->baseType.substr(2);
+        }
+        llvm::Type *type = getLLVMType(typeName);
+        if (!type || type->isVoidTy())
+            ERROR(line, "Unknown type: %s", typeName.c_str());
+
+        llvm::Value *slice = generateExpression(args[0].get(), nullptr);
+        if (!isSliceType(slice->getType()))
+            ERROR(line, "Builtin '@%s' expects a slice returned by @map_file", name.c_str());
+        data = builder.CreateExtractValue(slice, 0, "map.ptr");
+        llvm::Value *size = builder.getInt64(module->getDataLayout().getTypeAllocSize(type));
+        bytes = builder.CreateMul(builder.CreateExtractValue(slice, 1), size, "map.bytes");
+    };
+
+    if (name == "map_file" || name == "map_file_rw")
+    {
+        // @map_file<T>(path) maps the whole file as a []T (default []i8), read-only and
+        // private; @map_file_rw maps it shared and writable. A failed mapping yields a
+        // null, empty slice. A trailing partial element is left out of the length.
+        expectArgs(1, 1);
+        const std::string typeName = call->getTypeArgs().empty() ? "i8" : call->getTypeArgs()[0];
+        llvm::Type *type = call->getTypeArgs().empty() ? builder.getInt8Ty() : elementType();
+        llvm::Value *path = generateExpression(args[0].get(), ptr);
+        if (!path || !path->getType()->isPointerTy())
+            ERROR(line, "Builtin '@%s' expects a path", name.c_str());
+
+        llvm::AllocaInst *lengthSlot = createEntryBlockAlloca(builder.GetInsertBlock()->getParent(), "map.length", i64);
+        llvm::FunctionCallee mapFile = runtime("tvys_map_file", ptr, {ptr, builder.getInt32Ty(), ptr});
+        llvm::Value *data = builder.CreateCall(mapFile, {path, builder.getInt32(name == "map_file_rw"), lengthSlot}, "map.ptr");
+        llvm::Value *bytes = builder.CreateLoad(i64, lengthSlot, "map.bytes");
+        llvm::Value *length = builder.CreateUDiv(bytes, builder.getInt64(module->getDataLayout().getTypeAllocSize(type)), "map.len");
+        return makeSlice(getLLVMType("[]" + typeName), data, length);
+    }
+    else if (name == "advise")
+    {
+        expectArgs(2, 2);
+        llvm::Value *data, *bytes;
+        mappedRange(data, bytes);
+        llvm::Value *advice = builder.getInt32(parseAdvice(call, args[1].get()));
+        return builder.CreateCall(runtime("tvys_map_advise", builder.getInt32Ty(), {ptr, i64, builder.getInt32Ty()}), {data, bytes, advice}, "advise");
+    }
+    else if (name == "sync" || name == "unmap")
+    {
+        expectArgs(1, 1);
+        llvm::Value *data, *bytes;
+        mappedRange(data, bytes);
+        const char *function = name == "sync" ? "tvys_map_sync" : "tvys_unmap";
+        return builder.CreateCall(runtime(function, builder.getInt32Ty(), {ptr, i64}), {data, bytes}, name);
+    }
+    else if (name == "arena_new")
+    {
+        // @arena_new() or @arena_new(firstChunkBytes)
+        expectArgs(0, 1);
+        llvm::Value *chunkSize = args.empty() ? builder.getInt64(0) : generateCastExpression(args[0].get(), i64);
+        return builder.CreateCall(runtime("tvys_arena_new", ptr, {i64}), {chunkSize}, "arena");
+    }
+    else if (name == "arena_alloc")
+    {
+        // @arena_alloc<T>(a) or @arena_alloc<T>(a, n) returns room for n T's, uninitialised.
+        expectArgs(1, 2);
+        llvm::Type *type = elementType();
+        llvm::Value *arena = handle(0);
+        llvm::Value *count = args.size() > 1 ? generateCastExpression(args[1].get(), i64) : builder.getInt64(1);
+        const llvm::DataLayout &layout = module->getDataLayout();
+        const uint64_t align = layout.getABITypeAlign(type).value();
+
+        // An overflowing size is clamped so that it fails the fit check and the runtime reports it.
+        llvm::Value *product = builder.CreateIntrinsic(llvm::Intrinsic::umul_with_overflow, {i64},
+                                                       {count, builder.getInt64(layout.getTypeAllocSize(type))});
+        llvm::Value *size = builder.CreateSelect(builder.CreateExtractValue(product, 1), builder.getInt64(INT64_MAX),
+                                                 builder.CreateExtractValue(product, 0), "alloc.size");
+
+        llvm::StructType *arenaType = getArenaType(context);
+        llvm::Value *cursorPtr = builder.CreateStructGEP(arenaType, arena, 0);
+        llvm::Value *cursor = builder.CreateLoad(ptr, cursorPtr, "arena.cursor");
+        llvm::Value *limit = builder.CreateLoad(ptr, builder.CreateStructGEP(arenaType, arena, 1), "arena.limit");
+        llvm::Value *start = builder.CreatePtrToInt(cursor, i64);
+        llvm::Value *aligned = builder.CreateAnd(builder.CreateAdd(start, builder.getInt64(align - 1)), builder.getInt64(~(align - 1)));
+        llvm::Value *padding = builder.CreateSub(aligned, start, "alloc.padding");
+        llvm::Value *needed = builder.CreateAdd(padding, size, "alloc.needed");
+        llvm::Value *available = builder.CreateSub(builder.CreatePtrToInt(limit, i64), start, "arena.available");
+
+        llvm::Function *function = builder.GetInsertBlock()->getParent();
+        llvm::BasicBlock *fastBlock = llvm::BasicBlock::Create(context, "arena.bump", function);
+        llvm::BasicBlock *slowBlock = llvm::BasicBlock::Create(context, "arena.refill", function);
+        llvm::BasicBlock *doneBlock = llvm::BasicBlock::Create(context, "arena.done", function);
+        builder.CreateCondBr(builder.CreateICmpULE(needed, available), fastBlock, slowBlock, llvm::MDBuilder(context).createBranchWeights(2000, 1));
+
+        builder.SetInsertPoint(fastBlock);
+        llvm::Value *result = builder.CreateGEP(builder.getInt8Ty(), cursor, padding, "arena.ptr");
+        builder.CreateStore(builder.CreateGEP(builder.getInt8Ty(), cursor, needed), cursorPtr);
+        llvm::Value *allocsPtr = builder.CreateStructGEP(arenaType, arena, 2);
+        builder.CreateStore(builder.CreateAdd(builder.CreateLoad(i64, allocsPtr), builder.getInt64(1)), allocsPtr);
+        builder.CreateBr(doneBlock);
+
+        builder.SetInsertPoint(slowBlock);
+        llvm::CallInst *refilled = builder.CreateCall(runtime("tvys_arena_alloc_slow", ptr, {ptr, i64, i64}), {arena, size, builder.getInt64(align)}, "arena.ptr");
+        builder.CreateBr(doneBlock);
+
+        builder.SetInsertPoint(doneBlock);
+        llvm::PHINode *memory = builder.CreatePHI(ptr, 2, "alloc");
+        memory->addIncoming(result, fastBlock);
+        memory->addIncoming(refilled, slowBlock);
+        return memory;
+    }
+    else if (name == "arena_mark")
+    {
+        expectArgs(1, 1);
+        return builder.CreateCall(runtime("tvys_arena_mark", i64, {ptr}), {handle(0)}, "arena.mark");
+    }
+    else if (name == "arena_release")
+    {
+        expectArgs(2, 2);
+        llvm::Value *arena = handle(0);
+        llvm::Value *mark = generateCastExpression(args[1].get(), i64);
+        return builder.CreateCall(runtime("tvys_arena_release", builder.getVoidTy(), {ptr, i64}), {arena, mark});
+    }
+    else if (name == "arena_reset" || name == "arena_free")
+    {
+        expectArgs(1, 1);
+        const char *function = name == "arena_reset" ? "tvys_arena_reset" : "tvys_arena_free";
+        return builder.CreateCall(runtime(function, builder.getVoidTy(), {ptr}), {handle(0)});
+    }
+    else if (name == "arena_used")
+        return readStatistic("tvys_arena_used");
+    else if (name == "arena_peak")
+        return readStatistic("tvys_arena_peak");
+    else if (name == "arena_allocs")
+    {
+        expectArgs(1, 1);
+        return builder.CreateLoad(i64, builder.CreateStructGEP(getArenaType(context), handle(0), 2), "arena.allocs");
+    }
+    else if (name == "pool_new")
+    {
+        // @pool_new<T>() makes a pool of T-sized objects.
+        expectArgs(0, 0);
+        llvm::Type *type = elementType();
+        const llvm::DataLayout &layout = module->getDataLayout();
+        return builder.CreateCall(runtime("tvys_pool_new", ptr, {i64, i64}),
+                                  {builder.getInt64(layout.getTypeAllocSize(type)), builder.getInt64(layout.getABITypeAlign(type).value())}, "pool");
+    }
+    else if (name == "pool_alloc")
+    {
+        expectArgs(1, 1);
+        llvm::Value *pool = handle(0);
+        llvm::StructType *poolType = getPoolType(context);
+        llvm::Value *freePtr = builder.CreateStructGEP(poolType, pool, 0);
+        llvm::Value *head = builder.CreateLoad(ptr, freePtr, "pool.head");
+
+        llvm::Function *function = builder.GetInsertBlock()->getParent();
+        llvm::BasicBlock *fastBlock = llvm::BasicBlock::Create(context, "pool.pop", function);
+        llvm::BasicBlock *slowBlock = llvm::BasicBlock::Create(context, "pool.refill", function);
+        llvm::BasicBlock *doneBlock = llvm::BasicBlock::Create(context, "pool.done", function);
+        builder.CreateCondBr(builder.CreateIsNotNull(head), fastBlock, slowBlock, llvm::MDBuilder(context).createBranchWeights(2000, 1));
+
+        builder.SetInsertPoint(fastBlock);
+        builder.CreateStore(builder.CreateLoad(ptr, head, "pool.next"), freePtr);
+        llvm::Value *livePtr = builder.CreateStructGEP(poolType, pool, 1);
+        builder.CreateStore(builder.CreateAdd(builder.CreateLoad(i64, livePtr), builder.getInt64(1)), livePtr);
+        builder.CreateBr(doneBlock);
+
+        builder.SetInsertPoint(slowBlock);
+        llvm::CallInst *refilled = builder.CreateCall(runtime("tvys_pool_alloc_slow", ptr, {ptr}), {pool}, "pool.object");
+        builder.CreateBr(doneBlock);
+
+        builder.SetInsertPoint(doneBlock);
+        llvm::PHINode *object = builder.CreatePHI(ptr, 2, "object");
+        object->addIncoming(head, fastBlock);
+        object->addIncoming(refilled, slowBlock);
+        return object;
+    }
+    else if (name == "pool_free")
+    {
+        // @pool_free(p, object) pushes the object back onto the free list.
+        expectArgs(2, 2);
+        llvm::Value *pool = handle(0);
+        llvm::Value *object = generateExpression(args[1].get(), ptr);
+        if (!object->getType()->isPointerTy())
+            ERROR(line, "Builtin '@pool_free' expects a pointer to an object of the pool");
+        llvm::StructType *poolType = getPoolType(context);
+        llvm::Value *freePtr = builder.CreateStructGEP(poolType, pool, 0);
+        builder.CreateStore(builder.CreateLoad(ptr, freePtr, "pool.head"), object);
+        builder.CreateStore(object, freePtr);
+        llvm::Value *livePtr = builder.CreateStructGEP(poolType, pool, 1);
+        return builder.CreateStore(builder.CreateSub(builder.CreateLoad(i64, livePtr), builder.getInt64(1)), livePtr);
+    }
+    else if (name == "pool_live")
+    {
+        expectArgs(1, 1);
+        return builder.CreateLoad(i64, builder.CreateStructGEP(getPoolType(context), handle(0), 1), "pool.live");
+    }
+    else if (name == "pool_destroy")
+    {
+        expectArgs(1, 1);
+        return builder.CreateCall(runtime("tvys_pool_free", builder.getVoidTy(), {ptr}), {handle(0)});
+    }
+
+    ERROR(line, "Unknown builtin '@%s'", name.c_str());
+    return nullptr;
+}
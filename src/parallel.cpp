@@ -0,0 +1,315 @@
+#include "../include/codegen.hpp"
+#include "../include/walk.hpp"
+#include "../include/error.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+// A parallel for is outlined into `void body(ptr ctx, i64 lo, i64 hi)`, which runs the
+// loop over [lo, hi), and the loop itself becomes a call to tvys_parallel_for in the
+// runtime, which splits the range across its worker threads. Variables the body only
+// reads are copied into the context struct; variables it writes, aggregates and
+// reduction targets are passed by address.
+
+std::unordered_set<std::string> CodeGenerator::collectParallelWrites(const NodeFor *node)
+{
+    std::unordered_set<std::string> written;
+    for (const auto &reduction : node->getReductions())
+        written.insert(reduction.varName);
+    walkTree(node->getBody(), [&](const Node *child)
+             {
+        if (auto assign = dynamic_cast<const NodeAssignment *>(child))
+            written.insert(assign->getName()); });
+    return written;
+}
+
+// Names the body refers to, in order of first use.
+static std::vector<std::string> collectReferencedNames(const Node *body)
+{
+    std::vector<std::string> names;
+    std::unordered_set<std::string> seen;
+    walkTree(body, [&](const Node *child)
+             {
+        const std::string *name = nullptr;
+        if (auto id = dynamic_cast<const NodeIdentifier *>(child))
+            name = &id->getName();
+        else if (auto assign = dynamic_cast<const NodeAssignment *>(child))
+            name = &assign->getName();
+        else if (auto access = dynamic_cast<const NodeArrayAccess *>(child))
+            name = &access->getName();
+        else if (auto assign = dynamic_cast<const NodeArrayAssignment *>(child))
+            name = &assign->getName();
+        if (name && seen.insert(*name).second)
+            names.push_back(*name); });
+    return names;
+}
+
+static llvm::Constant *reductionIdentity(const std::string &op, llvm::Type *type)
+{
+    if (type->isFloatingPointTy())
+    {
+        if (op == "+")
+            return llvm::ConstantFP::getNegativeZero(type);
+        if (op == "*")
+            return llvm::ConstantFP::get(type, 1.0);
+        if (op == "min")
+            return llvm::ConstantFP::getInfinity(type, false);
+        if (op == "max")
+            return llvm::ConstantFP::getInfinity(type, true);
+        return nullptr;
+    }
+
+    const unsigned bits = type->getIntegerBitWidth();
+    if (op == "+" || op == "|" || op == "^")
+        return llvm::ConstantInt::get(type, 0);
+    if (op == "*")
+        return llvm::ConstantInt::get(type, 1);
+    if (op == "&")
+        return llvm::ConstantInt::getAllOnesValue(type);
+    if (op == "min")
+        return llvm::ConstantInt::get(type, llvm::APInt::getSignedMaxValue(bits));
+    return llvm::ConstantInt::get(type, llvm::APInt::getSignedMinValue(bits));
+}
+
+void CodeGenerator::generateParallelFor(const NodeFor *node)
+{
+    walkTree(node->getBody(), [&](const Node *child)
+             {
+        if (dynamic_cast<const NodeReturn *>(child))
+            ERROR(child->getLine(), "'return' is not allowed inside a parallel for"); });
+
+    llvm::Type *indexType = builder.getInt64Ty();
+    llvm::Value *start = generateCastExpression(node->getStart(), indexType);
+    llvm::Value *end = generateCastExpression(node->getEnd(), indexType);
+
+    // A grain of 0 lets the runtime pick one from the trip count and the number of workers.
+    int64_t grain = 0;
+    for (const auto &attr : node->getAttributes())
+    {
+        if (attr.getName() != "grain")
+            continue;
+        char *endPtr = nullptr;
+        grain = attr.getArgs().size() == 1 ? strtoll(attr.getArgs()[0].c_str(), &endPtr, 10) : 0;
+        if (grain <= 0 || *endPtr != '\0')
+            ERROR(attr.getLine(), "Attribute 'grain' expects a positive iteration count");
+    }
+
+    std::vector<std::string> names;
+    for (const auto &reduction : node->getReductions())
+        names.push_back(reduction.varName);
+    for (const auto &name : collectReferencedNames(node->getBody()))
+    {
+        if (std::find(names.begin(), names.end(), name) == names.end())
+            names.push_back(name);
+    }
+
+    const std::unordered_set<std::string> written = collectParallelWrites(node);
+    std::vector<ParallelCapture> captures;
+    std::vector<llvm::Type *> fieldTypes;
+    for (const auto &name : names)
+    {
+        const NodeFor::Reduction *reduction = nullptr;
+        for (const auto &candidate : node->getReductions())
+        {
+            if (candidate.varName == name)
+                reduction = &candidate;
+        }
+
+        const SymbolTable::Symbol *sym = symbolTable.lookupVariable(name);
+        if (reduction && !sym)
+            ERROR(reduction->line, "Undefined reduction variable: %s", name.c_str());
+        if (!sym || name == node->getVarName())
+            continue;
+        // Globals are reachable from the outlined function directly.
+        const bool isGlobal = sym->value && llvm::isa<llvm::GlobalValue>(sym->value);
+        if (isGlobal && !reduction)
+            continue;
+
+        if (reduction)
+        {
+            if (!sym->type->isIntegerTy() && !sym->type->isFloatingPointTy())
+                ERROR(reduction->line, "Reduction variable '%s' must be an integer or floating-point scalar", name.c_str());
+            // The partial results are combined with atomicrmw, which has no form for bool.
+            if (sym->type->isIntegerTy(1))
+                ERROR(reduction->line, "Reduction variable '%s' cannot be a bool", name.c_str());
+            if (!reductionIdentity(reduction->op, sym->type))
+                ERROR(reduction->line, "Reduction '%s' is not defined for floating-point values", reduction->op.c_str());
+            if (sym->isConst)
+                ERROR(reduction->line, "Cannot reduce into constant '%s'", name.c_str());
+        }
+
+        const bool byValue = !written.count(name) &&
+                             (sym->type->isIntegerTy() || sym->type->isFloatingPointTy() || sym->type->isPointerTy() ||
+                              sym->type->isVectorTy() || isSliceType(sym->type));
+        if (!byValue && (sym->isValue || sym->ssaSlot >= 0))
+            ERROR(node->getLine(), "Variable '%s' cannot be modified inside a parallel for", name.c_str());
+
+        captures.push_back({name, *sym, !byValue, reduction});
+        fieldTypes.push_back(byValue ? sym->type : builder.getPtrTy());
+    }
+
+    llvm::Function *function = builder.GetInsertBlock()->getParent();
+    llvm::StructType *contextType = llvm::StructType::get(context, fieldTypes);
+    llvm::AllocaInst *contextPtr = createEntryBlockAlloca(function, "parallel.ctx", contextType);
+    for (size_t i = 0; i < captures.size(); i++)
+    {
+        const ParallelCapture &capture = captures[i];
+        llvm::Value *field = builder.CreateStructGEP(contextType, contextPtr, i, capture.name + ".capture");
+        builder.CreateStore(capture.byReference ? capture.symbol.value : loadVariable(&capture.symbol, capture.name), field);
+    }
+
+    llvm::Function *body = outlineParallelBody(node, captures, contextType);
+
+    llvm::FunctionCallee runtime = module->getOrInsertFunction("tvys_parallel_for", builder.getVoidTy(), builder.getPtrTy(),
+                                                               builder.getPtrTy(), indexType, indexType, indexType);
+    builder.CreateCall(runtime, {body, contextPtr, start, end, builder.getInt64(grain)});
+}
+
+llvm::Function *CodeGenerator::outlineParallelBody(const NodeFor *node, const std::vector<ParallelCapture> &captures, llvm::StructType *contextType)
+{
+    llvm::Type *indexType = builder.getInt64Ty();
+    llvm::FunctionType *type = llvm::FunctionType::get(builder.getVoidTy(), {builder.getPtrTy(), indexType, indexType}, false);
+    llvm::Function *parent = currentFunction;
+    llvm::Function *body = llvm::Function::Create(type, llvm::Function::InternalLinkage, parent->getName() + ".parallel", module.get());
+    body->addFnAttr(llvm::Attribute::NoUnwind);
+    llvm::Argument *contextPtr = body->getArg(0);
+    llvm::Argument *low = body->getArg(1);
+    llvm::Argument *high = body->getArg(2);
+    contextPtr->setName("ctx");
+    low->setName("lo");
+    high->setName("hi");
+
+    // The body is generated in the middle of its parent, so the per-function state
+    // is set aside and restored once the outlined function is complete.
+    const llvm::IRBuilderBase::InsertPoint savedInsertPoint = builder.saveIP();
+    const bool savedHasReturn = hasReturn;
+    auto savedAddressTaken = std::move(addressTaken);
+    auto savedSSAVariables = std::move(ssaVariables);
+    auto savedUnsealedBlocks = std::move(unsealedBlocks);
+    auto savedIncompletePhis = std::move(incompletePhis);
+    auto savedPendingPhis = std::move(pendingPhis);
+    const CoroutineState savedCoroutine = coroutine;
+    llvm::DISubprogram *savedDebugScope = debugScope;
+    auto savedDebugPhis = std::move(debugPhis);
+    const llvm::DebugLoc savedDebugLocation = builder.getCurrentDebugLocation();
+    coroutine = CoroutineState();
+    debugPhis.clear();
+    resetSSAState();
+
+    currentFunction = body;
+    llvm::BasicBlock *entry = llvm::BasicBlock::Create(context, "entry", body);
+    builder.SetInsertPoint(entry);
+    beginDebugFunction(body, nullptr, node->getLine());
+    collectAddressTaken(node->getBody());
+
+    // Each worker accumulates reductions in a private copy that starts at the identity.
+    symbolTable.enterScope();
+    std::vector<std::pair<const ParallelCapture *, llvm::Value *>> reductions;
+    std::vector<SymbolTable::Symbol *> privates;
+    for (size_t i = 0; i < captures.size(); i++)
+    {
+        const ParallelCapture &capture = captures[i];
+        llvm::Type *fieldType = contextType->getElementType(i);
+        llvm::Value *field = builder.CreateStructGEP(contextType, contextPtr, i);
+        llvm::Value *value = builder.CreateLoad(fieldType, field, capture.name);
+
+        SymbolTable::Symbol &sym = symbolTable.addVariable(capture.name, value, capture.symbol.type, capture.symbol.baseType);
+        sym.aliasScope = capture.symbol.aliasScope;
+        sym.isConst = capture.symbol.isConst;
+        if (capture.reduction)
+        {
+            llvm::Constant *identity = reductionIdentity(capture.reduction->op, sym.type);
+            if (canPromote(capture.name, sym.type))
+            {
+                sym.value = nullptr;
+                sym.ssaSlot = declareSSAVariable(capture.name, sym.type);
+                writeVariable(sym.ssaSlot, entry, identity);
+            }
+            else
+            {
+                sym.value = createEntryBlockAlloca(body, capture.name + ".partial", sym.type);
+                builder.CreateStore(identity, sym.value);
+            }
+            reductions.push_back({&capture, value});
+            privates.push_back(&sym);
+        }
+        else if (!capture.byReference)
+            sym.isValue = true;
+    }
+
+    emitForRange(node, low, high, builder.getInt64(1), false);
+
+    // All partial results are read before combining, since combining may add blocks.
+    std::vector<llvm::Value *> partials;
+    for (SymbolTable::Symbol *sym : privates)
+        partials.push_back(loadVariable(sym, "partial"));
+    for (size_t i = 0; i < reductions.size(); i++)
+        emitReductionCombine(*reductions[i].first->reduction, reductions[i].second, partials[i]);
+    builder.CreateRetVoid();
+    symbolTable.exitScope();
+    finishDebugFunction();
+
+    addressTaken = std::move(savedAddressTaken);
+    ssaVariables = std::move(savedSSAVariables);
+    unsealedBlocks = std::move(savedUnsealedBlocks);
+    incompletePhis = std::move(savedIncompletePhis);
+    pendingPhis = std::move(savedPendingPhis);
+    coroutine = savedCoroutine;
+    debugScope = savedDebugScope;
+    debugPhis = std::move(savedDebugPhis);
+    hasReturn = savedHasReturn;
+    currentFunction = parent;
+    builder.restoreIP(savedInsertPoint);
+    builder.SetCurrentDebugLocation(savedDebugLocation);
+    return body;
+}
+
+void CodeGenerator::emitReductionCombine(const NodeFor::Reduction &reduction, llvm::Value *shared, llvm::Value *partial)
+{
+    static const std::unordered_map<std::string, llvm::AtomicRMWInst::BinOp> intOps = {
+        {"+", llvm::AtomicRMWInst::Add},
+        {"&", llvm::AtomicRMWInst::And},
+        {"|", llvm::AtomicRMWInst::Or},
+        {"^", llvm::AtomicRMWInst::Xor},
+        {"min", llvm::AtomicRMWInst::Min},
+        {"max", llvm::AtomicRMWInst::Max}};
+    static const std::unordered_map<std::string, llvm::AtomicRMWInst::BinOp> floatOps = {
+        {"+", llvm::AtomicRMWInst::FAdd},
+        {"min", llvm::AtomicRMWInst::FMin},
+        {"max", llvm::AtomicRMWInst::FMax}};
+
+    // The runtime joins the workers before the loop returns, which orders these
+    // updates before any later read, so relaxed ordering is enough.
+    llvm::Type *type = partial->getType();
+    const llvm::Align align(module->getDataLayout().getTypeStoreSize(type));
+    const auto &ops = type->isFloatingPointTy() ? floatOps : intOps;
+    if (auto it = ops.find(reduction.op); it != ops.end())
+    {
+        builder.CreateAtomicRMW(it->second, shared, partial, align, llvm::AtomicOrdering::Monotonic);
+        return;
+    }
+
+    // There is no atomic multiply, so products are folded in with a compare-exchange loop
+    // on the value's bits.
+    llvm::Type *bitsType = builder.getIntNTy(type->getPrimitiveSizeInBits());
+    llvm::Function *function = builder.GetInsertBlock()->getParent();
+    llvm::BasicBlock *before = builder.GetInsertBlock();
+    llvm::BasicBlock *loopBlock = llvm::BasicBlock::Create(context, "reduce.cas", function);
+    llvm::BasicBlock *doneBlock = llvm::BasicBlock::Create(context, "reduce.done", function);
+
+    llvm::LoadInst *initial = builder.CreateAlignedLoad(bitsType, shared, align, "reduce.initial");
+    initial->setAtomic(llvm::AtomicOrdering::Monotonic);
+    builder.CreateBr(loopBlock);
+
+    builder.SetInsertPoint(loopBlock);
+    llvm::PHINode *current = builder.CreatePHI(bitsType, 2, "reduce.current");
+    current->addIncoming(initial, before);
+    llvm::Value *currentValue = builder.CreateBitCast(current, type);
+    llvm::Value *product = type->isFloatingPointTy() ? builder.CreateFMul(currentValue, partial, "reduce.product")
+                                                     : builder.CreateMul(currentValue, partial, "reduce.product");
+    llvm::AtomicCmpXchgInst *cas = builder.CreateAtomicCmpXchg(shared, current, builder.CreateBitCast(product, bitsType), align,
+                                                               llvm::AtomicOrdering::Monotonic, llvm::AtomicOrdering::Monotonic);
+    current->addIncoming(builder.CreateExtractValue(cas, 0, "reduce.seen"), loopBlock);
+    builder.CreateCondBr(builder.CreateExtractValue(cas, 1, "reduce.ok"), doneBlock, loopBlock);
+
+    builder.SetInsertPoint(doneBlock);
+}
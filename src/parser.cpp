@@ -1,3 +1,4 @@
+#include <cerrno>
 #include <stdexcept>
 #include "../include/error.hpp"
 #include "../include/parser.hpp"
@@ -10,13 +11,18 @@ const std::vector<Token::Kind> COMPARISON_OPS = {
 	Token::Kind::TOKEN_LESS,
 	Token::Kind::TOKEN_GREATER};
 
+const std::vector<Token::Kind> SHIFT_OPS = {
+	Token::Kind::TOKEN_SHL,
+	Token::Kind::TOKEN_SHR};
+
 const std::vector<Token::Kind> ADDITIVE_OPS = {
 	Token::Kind::TOKEN_PLUS,
 	Token::Kind::TOKEN_MINUS};
 
 const std::vector<Token::Kind> MULTIPLICATIVE_OPS = {
 	Token::Kind::TOKEN_STAR,
-	Token::Kind::TOKEN_SLASH};
+	Token::Kind::TOKEN_SLASH,
+	Token::Kind::TOKEN_PERCENT};
 
 std::unique_ptr<Node> Parser::parse()
 {
@@ -28,14 +34,100 @@ std::unique_ptr<Node> Parser::parse()
 
 std::unique_ptr<Node> Parser::parseExpression()
 {
-	return parseComparison();
+	return parseLogicalOr();
+}
+
+std::unique_ptr<Node> Parser::parseLogicalOr()
+{
+	auto left = parseLogicalAnd();
+
+	while (matchMultipleTokens({Token::Kind::TOKEN_PIPE_PIPE}))
+	{
+		const int line = previous().getLine();
+		auto right = parseLogicalAnd();
+		left = std::make_unique<NodeBinaryOp>(Token::Kind::TOKEN_PIPE_PIPE, std::move(left), std::move(right), line);
+	}
+
+	return left;
+}
+
+std::unique_ptr<Node> Parser::parseLogicalAnd()
+{
+	auto left = parseComparison();
+
+	while (matchMultipleTokens({Token::Kind::TOKEN_AND_AND}))
+	{
+		const int line = previous().getLine();
+		auto right = parseComparison();
+		left = std::make_unique<NodeBinaryOp>(Token::Kind::TOKEN_AND_AND, std::move(left), std::move(right), line);
+	}
+
+	return left;
 }
 
 std::unique_ptr<Node> Parser::parseComparison()
 {
-	auto left = parseAdditive();
+	auto left = parseBitwiseOr();
 
 	while (matchMultipleTokens(COMPARISON_OPS))
+	{
+		const Token::Kind op = previous().getKind();
+		const int line = previous().getLine();
+		auto right = parseBitwiseOr();
+		left = std::make_unique<NodeBinaryOp>(op, std::move(left), std::move(right), line);
+	}
+
+	return left;
+}
+
+// Bitwise operators bind tighter than comparisons, so `x & mask == 0` tests the masked value.
+std::unique_ptr<Node> Parser::parseBitwiseOr()
+{
+	auto left = parseBitwiseXor();
+
+	while (matchMultipleTokens({Token::Kind::TOKEN_PIPE}))
+	{
+		const int line = previous().getLine();
+		auto right = parseBitwiseXor();
+		left = std::make_unique<NodeBinaryOp>(Token::Kind::TOKEN_PIPE, std::move(left), std::move(right), line);
+	}
+
+	return left;
+}
+
+std::unique_ptr<Node> Parser::parseBitwiseXor()
+{
+	auto left = parseBitwiseAnd();
+
+	while (matchMultipleTokens({Token::Kind::TOKEN_CARET}))
+	{
+		const int line = previous().getLine();
+		auto right = parseBitwiseAnd();
+		left = std::make_unique<NodeBinaryOp>(Token::Kind::TOKEN_CARET, std::move(left), std::move(right), line);
+	}
+
+	return left;
+}
+
+std::unique_ptr<Node> Parser::parseBitwiseAnd()
+{
+	auto left = parseShift();
+
+	while (matchMultipleTokens({Token::Kind::TOKEN_AMPERSAND}))
+	{
+		const int line = previous().getLine();
+		auto right = parseShift();
+		left = std::make_unique<NodeBinaryOp>(Token::Kind::TOKEN_AMPERSAND, std::move(left), std::move(right), line);
+	}
+
+	return left;
+}
+
+std::unique_ptr<Node> Parser::parseShift()
+{
+	auto left = parseAdditive();
+
+	while (matchMultipleTokens(SHIFT_OPS))
 	{
 		const Token::Kind op = previous().getKind();
 		const int line = previous().getLine();
@@ -83,11 +175,17 @@ std::unique_ptr<Node> Parser::parseFactor()
 
 std::unique_ptr<Node> Parser::parseUnary()
 {
-	if (matchSingleToken(Token::Kind::TOKEN_STAR) || matchSingleToken(Token::Kind::TOKEN_AMPERSAND))
+	if (matchSingleToken(Token::Kind::TOKEN_STAR) || matchSingleToken(Token::Kind::TOKEN_AMPERSAND) ||
+		matchSingleToken(Token::Kind::TOKEN_BANG))
 	{
 		const Token::Kind op = peek().getKind();
-		consumeToken();
-		return std::make_unique<NodeUnaryOp>(op, parseUnary(), previous().getLine());
+		const int line = consumeToken().getLine();
+		return std::make_unique<NodeUnaryOp>(op, parseUnary(), line);
+	}
+	if (matchSingleToken(Token::Kind::TOKEN_AWAIT))
+	{
+		const int line = consumeToken().getLine();
+		return std::make_unique<NodeAwait>(parseUnary(), line);
 	}
 
 	return parsePrimary();
@@ -101,27 +199,56 @@ std::unique_ptr<Node> Parser::parsePrimary()
 		return parseNumberLiteral();
 	if (matchSingleToken(Token::Kind::TOKEN_STRING))
 		return parseStringLiteral();
+	if (matchSingleToken(Token::Kind::TOKEN_TRUE) || matchSingleToken(Token::Kind::TOKEN_FALSE))
+	{
+		const Token boolToken = consumeToken();
+		return std::make_unique<NodeBool>(boolToken.getKind() == Token::Kind::TOKEN_TRUE, boolToken.getLine());
+	}
 	if (matchSingleToken(Token::Kind::TOKEN_IDENTIFIER))
 		return parseIdentifierExpression();
+	if (matchSingleToken(Token::Kind::TOKEN_BUILTIN))
+		return parseBuiltinCall();
 	if (matchSingleToken(Token::Kind::TOKEN_LPAREN))
 		return parseParenthesizedExpression();
+	if (matchSingleToken(Token::Kind::TOKEN_LBRACKET))
+		return parseArrayLiteral();
 
 	ERROR(line, "Unexpected token in primary: '%s'", peek().getValue().c_str());
 }
 
+// Decimal, or hex with a 0x prefix; a leading zero does not make a literal octal. Hex
+// literals may use all 64 bits, so they are parsed unsigned and kept as a bit pattern.
+static int64_t parseIntegerText(const std::string &numStr, int line)
+{
+	char *end;
+	const bool isHex = numStr.size() > 2 && numStr[0] == '0' && (numStr[1] == 'x' || numStr[1] == 'X');
+	errno = 0;
+	const int64_t num = isHex ? static_cast<int64_t>(strtoull(numStr.c_str() + 2, &end, 16))
+							  : strtoll(numStr.c_str(), &end, 10);
+
+	if (end != numStr.c_str() + numStr.size() || errno == ERANGE)
+	{
+		ERROR(line, "Invalid integer: %s", numStr.c_str());
+	}
+	return num;
+}
+
 std::unique_ptr<Node> Parser::parseNumberLiteral()
 {
 	const Token numToken = consumeToken();
 	char *end;
 	const std::string &numStr = numToken.getValue();
-	const long num = strtol(numStr.c_str(), &end, 10);
 
-	if (end != numStr.c_str() + numStr.size())
+	if (numStr.find('.') != std::string::npos)
 	{
-		ERROR(numToken.getLine(), "Invalid integer: %s", numStr.c_str());
+		const double value = strtod(numStr.c_str(), &end);
+		if (end != numStr.c_str() + numStr.size())
+			ERROR(numToken.getLine(), "Invalid floating-point literal: %s", numStr.c_str());
+		return std::make_unique<NodeFloat>(value, numToken.getLine());
 	}
 
-	return std::make_unique<NodeNumber>(static_cast<int>(num), numToken.getLine());
+	const int64_t num = parseIntegerText(numStr, numToken.getLine());
+	return std::make_unique<NodeNumber>(num, numToken.getLine());
 }
 
 std::unique_ptr<Node> Parser::parseStringLiteral()
@@ -167,10 +294,41 @@ std::unique_ptr<Node> Parser::parseCastOperation(std::unique_ptr<Node> expr)
 	consumeToken(Token::Kind::TOKEN_ARROW, "Expected '->'");
 	const std::string targetType = parseType();
 	consumeToken(Token::Kind::TOKEN_RPAREN, "Expected ')' after cast");
-	return std::make_unique<NodeCast>(targetType, std::move(expr), expr->getLine());
+	const int line = expr->getLine();
+	return std::make_unique<NodeCast>(targetType, std::move(expr), line);
 }
 
 std::unique_ptr<Node> Parser::parseFunctionCall(const std::string &name, int line)
+{
+	auto args = parseCallArguments();
+	return std::make_unique<NodeFunctionCall>(name, std::move(args), line);
+}
+
+std::unique_ptr<Node> Parser::parseBuiltinCall()
+{
+	const Token nameToken = consumeToken(Token::Kind::TOKEN_BUILTIN, "Expected builtin name");
+	std::vector<std::string> typeArgs;
+
+	if (matchSingleToken(Token::Kind::TOKEN_LESS))
+	{
+		consumeToken();
+		typeArgs.push_back(parseType());
+		while (matchSingleToken(Token::Kind::TOKEN_COMMA))
+		{
+			consumeToken();
+			typeArgs.push_back(parseType());
+		}
+		consumeToken(Token::Kind::TOKEN_GREATER, "Expected '>' after builtin type arguments");
+	}
+
+	if (!matchSingleToken(Token::Kind::TOKEN_LPAREN))
+		ERROR(nameToken.getLine(), "Expected '(' after builtin '@%s'", nameToken.getValue().c_str());
+
+	auto args = parseCallArguments();
+	return std::make_unique<NodeBuiltinCall>(nameToken.getValue(), std::move(typeArgs), std::move(args), nameToken.getLine());
+}
+
+std::vector<std::unique_ptr<Node>> Parser::parseCallArguments()
 {
 	consumeToken(Token::Kind::TOKEN_LPAREN, "Expected '('");
 	std::vector<std::unique_ptr<Node>> args;
@@ -184,7 +342,24 @@ std::unique_ptr<Node> Parser::parseFunctionCall(const std::string &name, int lin
 	}
 
 	consumeToken(Token::Kind::TOKEN_RPAREN, "Expected ')'");
-	return std::make_unique<NodeFunctionCall>(name, std::move(args), line);
+	return args;
+}
+
+std::unique_ptr<Node> Parser::parseArrayLiteral()
+{
+	const int line = consumeToken(Token::Kind::TOKEN_LBRACKET, "Expected '['").getLine();
+	std::vector<std::unique_ptr<Node>> elements;
+
+	while (!matchSingleToken(Token::Kind::TOKEN_RBRACKET))
+	{
+		elements.push_back(parseExpression());
+		if (!matchSingleToken(Token::Kind::TOKEN_COMMA))
+			break;
+		consumeToken();
+	}
+
+	consumeToken(Token::Kind::TOKEN_RBRACKET, "Expected ']' after array literal");
+	return std::make_unique<NodeArrayLiteral>(std::move(elements), line);
 }
 
 std::unique_ptr<Node> Parser::parseArrayAccess(const std::string &name, int line)
@@ -198,8 +373,29 @@ std::unique_ptr<Node> Parser::parseArrayAccess(const std::string &name, int line
 std::string Parser::parseType()
 {
 	std::string typeStr;
+	if (matchSingleToken(Token::Kind::TOKEN_RESTRICT))
+	{
+		consumeToken();
+		typeStr = "restrict ";
+	}
+
+	if (matchSingleToken(Token::Kind::TOKEN_LBRACKET))
+	{
+		consumeToken();
+		consumeToken(Token::Kind::TOKEN_RBRACKET, "Expected ']' in slice type");
+		return typeStr + "[]" + parseType();
+	}
+
 	consumeToken(Token::Kind::TOKEN_INT_TYPE, "Expected base type");
-	typeStr = previous().getValue();
+	typeStr += previous().getValue();
+
+	// task<T> is the handle of an async fn returning T; a plain task returns nothing.
+	if (previous().getValue() == "task" && matchSingleToken(Token::Kind::TOKEN_LESS))
+	{
+		consumeToken();
+		typeStr += "<" + parseType() + ">";
+		consumeToken(Token::Kind::TOKEN_GREATER, "Expected '>' after task result type");
+	}
 
 	while (matchSingleToken(Token::Kind::TOKEN_STAR))
 	{
@@ -244,16 +440,29 @@ std::pair<std::string, std::string> Parser::parseArgument()
 
 std::unique_ptr<Node> Parser::parseStatement()
 {
-	if (matchSingleToken(Token::Kind::TOKEN_LET))
+	if (matchSingleToken(Token::Kind::TOKEN_HASH))
+		return parseAttributedStatement();
+	if (matchSingleToken(Token::Kind::TOKEN_LET) || matchSingleToken(Token::Kind::TOKEN_CONST) ||
+		matchSingleToken(Token::Kind::TOKEN_STATIC) || matchSingleToken(Token::Kind::TOKEN_THREAD_LOCAL))
 		return parseVariableDeclaration();
 	if (matchSingleToken(Token::Kind::TOKEN_FN))
 		return parseFunctionDeclaration();
+	if (matchSingleToken(Token::Kind::TOKEN_ASYNC))
+		return parseAsyncFunction();
 	if (matchSingleToken(Token::Kind::TOKEN_WHILE))
 		return parseWhileStatement();
+	if (matchSingleToken(Token::Kind::TOKEN_FOR))
+		return parseForStatement();
+	if (matchSingleToken(Token::Kind::TOKEN_PARALLEL))
+		return parseParallelFor();
 	if (matchSingleToken(Token::Kind::TOKEN_IF))
 		return parseIfStatement();
+	if (matchSingleToken(Token::Kind::TOKEN_MATCH))
+		return parseMatchStatement();
 	if (matchSingleToken(Token::Kind::TOKEN_RETURN))
 		return parseReturn();
+	if (matchSingleToken(Token::Kind::TOKEN_BECOME))
+		return parseBecome();
 	if (matchSingleToken(Token::Kind::TOKEN_EXTERN))
 		return parseExternDeclaration();
 
@@ -264,6 +473,86 @@ std::unique_ptr<Node> Parser::parseStatement()
 	return expr;
 }
 
+std::unique_ptr<Node> Parser::parseAttributedStatement()
+{
+	const int line = peek().getLine();
+	auto attributes = parseAttributes();
+
+	if (matchSingleToken(Token::Kind::TOKEN_WHILE))
+	{
+		auto stmt = parseWhileStatement();
+		static_cast<NodeWhile *>(stmt.get())->setAttributes(std::move(attributes));
+		return stmt;
+	}
+	if (matchSingleToken(Token::Kind::TOKEN_FOR) || matchSingleToken(Token::Kind::TOKEN_PARALLEL))
+	{
+		auto stmt = matchSingleToken(Token::Kind::TOKEN_PARALLEL) ? parseParallelFor() : parseForStatement();
+		auto forNode = static_cast<NodeFor *>(stmt.get());
+		for (const auto &attr : attributes)
+		{
+			if (attr.getName() == "grain" && !forNode->isParallel())
+				ERROR(attr.getLine(), "Attribute 'grain' only applies to 'parallel for' loops");
+		}
+		forNode->setAttributes(std::move(attributes));
+		return stmt;
+	}
+	if (matchSingleToken(Token::Kind::TOKEN_FN) || matchSingleToken(Token::Kind::TOKEN_ASYNC))
+	{
+		auto stmt = matchSingleToken(Token::Kind::TOKEN_ASYNC) ? parseAsyncFunction() : parseFunctionDeclaration();
+		static_cast<NodeFunctionDeclaration *>(stmt.get())->setAttributes(std::move(attributes));
+		return stmt;
+	}
+	if (matchSingleToken(Token::Kind::TOKEN_EXTERN))
+	{
+		auto stmt = parseExternDeclaration();
+		static_cast<NodeExternDeclaration *>(stmt.get())->setAttributes(std::move(attributes));
+		return stmt;
+	}
+
+	ERROR(line, "Attributes are not allowed on this statement");
+}
+
+std::vector<Attribute> Parser::parseAttributes()
+{
+	std::vector<Attribute> attributes;
+
+	while (matchSingleToken(Token::Kind::TOKEN_HASH))
+	{
+		consumeToken();
+		consumeToken(Token::Kind::TOKEN_LBRACKET, "Expected '[' after '#'");
+
+		while (true)
+		{
+			const Token nameToken = consumeToken(Token::Kind::TOKEN_IDENTIFIER, "Expected attribute name");
+			std::vector<std::string> args;
+
+			if (matchSingleToken(Token::Kind::TOKEN_LPAREN))
+			{
+				consumeToken();
+				while (!matchSingleToken(Token::Kind::TOKEN_RPAREN))
+				{
+					if (!matchSingleToken(Token::Kind::TOKEN_NUMBER) && !matchSingleToken(Token::Kind::TOKEN_IDENTIFIER))
+						ERROR(peek().getLine(), "Expected attribute argument");
+					args.push_back(consumeToken().getValue());
+					if (!matchSingleToken(Token::Kind::TOKEN_COMMA))
+						break;
+					consumeToken();
+				}
+				consumeToken(Token::Kind::TOKEN_RPAREN, "Expected ')' after attribute arguments");
+			}
+
+			attributes.emplace_back(nameToken.getValue(), std::move(args), nameToken.getLine());
+			if (!matchSingleToken(Token::Kind::TOKEN_COMMA))
+				break;
+			consumeToken();
+		}
+
+		consumeToken(Token::Kind::TOKEN_RBRACKET, "Expected ']' after attributes");
+	}
+
+	return attributes;
+}
+
 std::unique_ptr<NodeBlock> Parser::parseBlock()
 {
 	consumeToken(Token::Kind::TOKEN_LBRACE, "Expected '{'");
@@ -274,7 +563,7 @@ std::unique_ptr<NodeBlock> Parser::parseBlock()
 		block->addStatement(parseStatement());
 	}
 
-	consumeToken(Token::Kind::TOKEN_RBRACE, "Expected '}'");
+	block->setEndLine(consumeToken(Token::Kind::TOKEN_RBRACE, "Expected '}'").getLine());
 	return block;
 }
 
@@ -293,9 +582,39 @@ std::unique_ptr<Node> Parser::parseReturn()
 	return std::make_unique<NodeReturn>(std::move(expr), line);
 }
 
+std::unique_ptr<Node> Parser::parseBecome()
+{
+	const int line = consumeToken(Token::Kind::TOKEN_BECOME, "Expected 'become'").getLine();
+	auto call = parseExpression();
+	if (!dynamic_cast<const NodeFunctionCall *>(call.get()))
+		ERROR(line, "'become' must be followed by a function call");
+	if (matchSingleToken(Token::Kind::TOKEN_SEMI))
+		consumeToken();
+
+	auto returnNode = std::make_unique<NodeReturn>(std::move(call), line);
+	returnNode->setTailCall(true);
+	return returnNode;
+}
+
 std::unique_ptr<Node> Parser::parseVariableDeclaration()
 {
-	consumeToken(Token::Kind::TOKEN_LET, "Unexpected let");
+	const int line = peek().getLine();
+	bool isStatic = false;
+	bool isThreadLocal = false;
+	while (matchSingleToken(Token::Kind::TOKEN_STATIC) || matchSingleToken(Token::Kind::TOKEN_THREAD_LOCAL))
+	{
+		if (consumeToken().getKind() == Token::Kind::TOKEN_STATIC)
+			isStatic = true;
+		else
+			isThreadLocal = true;
+	}
+
+	const bool isConst = matchSingleToken(Token::Kind::TOKEN_CONST);
+	if (isConst)
+		consumeToken();
+	else
+		consumeToken(Token::Kind::TOKEN_LET, "Expected 'let' or 'const'");
+
 	const std::string name = consumeToken(Token::Kind::TOKEN_IDENTIFIER, "Expected variable name").getValue();
 	consumeToken(Token::Kind::TOKEN_COLON, "Expected ':'");
 
@@ -311,12 +630,14 @@ std::unique_ptr<Node> Parser::parseVariableDeclaration()
 	if (matchSingleToken(Token::Kind::TOKEN_SEMI))
 		consumeToken();
 
-	return std::make_unique<NodeVariableDeclaration>(name, typeStr, std::move(initializer), previous().getLine());
+	auto varDecl = std::make_unique<NodeVariableDeclaration>(name, typeStr, std::move(initializer), line);
+	varDecl->setStorage(isStatic, isConst, isThreadLocal);
+	return varDecl;
 }
 
 std::unique_ptr<Node> Parser::parseFunctionDeclaration()
 {
-	consumeToken(Token::Kind::TOKEN_FN, "Unexpected fn");
+	const int line = consumeToken(Token::Kind::TOKEN_FN, "Unexpected fn").getLine();
 	const std::string name = consumeToken(Token::Kind::TOKEN_IDENTIFIER, "Expected function name").getValue();
 
 	const auto args = parseArgumentList();
@@ -324,31 +645,131 @@ std::unique_ptr<Node> Parser::parseFunctionDeclaration()
 
 	const std::string returnType = parseType();
 	auto body = parseBlock();
-	return std::make_unique<NodeFunctionDeclaration>(name, args, std::move(body), returnType, previous().getLine());
+	return std::make_unique<NodeFunctionDeclaration>(name, args, std::move(body), returnType, line);
+}
+
+std::unique_ptr<Node> Parser::parseAsyncFunction()
+{
+	consumeToken(Token::Kind::TOKEN_ASYNC, "Expected 'async'");
+	if (!matchSingleToken(Token::Kind::TOKEN_FN))
+		ERROR(peek().getLine(), "Expected 'fn' after 'async'");
+	auto function = parseFunctionDeclaration();
+	static_cast<NodeFunctionDeclaration *>(function.get())->setAsync(true);
+	return function;
 }
 
 std::unique_ptr<Node> Parser::parseWhileStatement()
 {
-	consumeToken(Token::Kind::TOKEN_WHILE, "Expected 'while'");
-	consumeToken(Token::Kind::TOKEN_LPAREN, "Expected '(' after 'while'");
+	const int line = consumeToken(Token::Kind::TOKEN_WHILE, "Expected 'while'").getLine();
+	BranchHint hint = BranchHint::None;
+	auto condition = parseCondition("while", hint);
 
-	auto condition = parseExpression();
+	auto body = parseBlock();
+	auto whileNode = std::make_unique<NodeWhile>(std::move(condition), std::move(body), line);
+	whileNode->setHint(hint);
+	return whileNode;
+}
 
-	consumeToken(Token::Kind::TOKEN_RPAREN, "Expected ')' after condition");
+std::unique_ptr<Node> Parser::parseForStatement(bool parallel)
+{
+	const int line = consumeToken(Token::Kind::TOKEN_FOR, "Expected 'for'").getLine();
+	const std::string varName = consumeToken(Token::Kind::TOKEN_IDENTIFIER, "Expected loop variable name").getValue();
+
+	if (!matchSingleToken(Token::Kind::TOKEN_IDENTIFIER) || peek().getValue() != "in")
+		ERROR(peek().getLine(), "Expected 'in' after loop variable");
+	consumeToken();
+
+	auto start = parseExpression();
+	consumeToken(Token::Kind::TOKEN_DOT_DOT, "Expected '..' in range");
+	auto end = parseExpression();
+
+	std::unique_ptr<Node> step = nullptr;
+	if (matchSingleToken(Token::Kind::TOKEN_IDENTIFIER) && peek().getValue() == "step")
+	{
+		if (parallel)
+			ERROR(peek().getLine(), "'parallel for' does not support 'step'");
+		consumeToken();
+		step = parseExpression();
+	}
+
+	std::vector<NodeFor::Reduction> reductions;
+	while (matchSingleToken(Token::Kind::TOKEN_IDENTIFIER) && peek().getValue() == "reduce")
+	{
+		if (!parallel)
+			ERROR(peek().getLine(), "'reduce' is only allowed on 'parallel for' loops");
+		parseReduceClause(reductions);
+	}
 
 	auto body = parseBlock();
-	return std::make_unique<NodeWhile>(std::move(condition), std::move(body), previous().getLine());
+	auto forNode = std::make_unique<NodeFor>(varName, std::move(start), std::move(end), std::move(step), std::move(body), line);
+	if (parallel)
+		forNode->setParallel(std::move(reductions));
+	return forNode;
+}
+
+std::unique_ptr<Node> Parser::parseParallelFor()
+{
+	consumeToken(Token::Kind::TOKEN_PARALLEL, "Expected 'parallel'");
+	if (!matchSingleToken(Token::Kind::TOKEN_FOR))
+		ERROR(peek().getLine(), "Expected 'for' after 'parallel'");
+	return parseForStatement(true);
+}
+
+// reduce(op: a, b) where op is one of + * & | ^ min max.
+void Parser::parseReduceClause(std::vector<NodeFor::Reduction> &reductions)
+{
+	const int line = consumeToken().getLine();
+	consumeToken(Token::Kind::TOKEN_LPAREN, "Expected '(' after 'reduce'");
+
+	const Token opToken = consumeToken();
+	std::string op = opToken.getValue();
+	switch (opToken.getKind())
+	{
+	case Token::Kind::TOKEN_PLUS:
+	case Token::Kind::TOKEN_STAR:
+	case Token::Kind::TOKEN_AMPERSAND:
+	case Token::Kind::TOKEN_PIPE:
+	case Token::Kind::TOKEN_CARET:
+		break;
+	case Token::Kind::TOKEN_IDENTIFIER:
+		if (op == "min" || op == "max")
+			break;
+		[[fallthrough]];
+	default:
+		ERROR(line, "Unsupported reduction operator '%s'", op.c_str());
+	}
+	consumeToken(Token::Kind::TOKEN_COLON, "Expected ':' after reduction operator");
+
+	while (true)
+	{
+		const std::string name = consumeToken(Token::Kind::TOKEN_IDENTIFIER, "Expected reduction variable name").getValue();
+		for (const auto &reduction : reductions)
+		{
+			if (reduction.varName == name)
+				ERROR(line, "Variable '%s' appears in more than one reduction", name.c_str());
+		}
+		reductions.push_back({op, name, line});
+
+		if (!matchSingleToken(Token::Kind::TOKEN_COMMA))
+			break;
+		consumeToken();
+	}
+
+	consumeToken(Token::Kind::TOKEN_RPAREN, "Expected ')' after reduction variables");
 }
 
 std::unique_ptr<Node> Parser::parseIfStatement()
 {
-	consumeToken(Token::Kind::TOKEN_IF, "Expected 'if'");
-	consumeToken(Token::Kind::TOKEN_LPAREN, "Expected '(' after 'if'");
-	auto condition = parseExpression();
-	consumeToken(Token::Kind::TOKEN_RPAREN, "Expected ')' after condition");
+	const int line = consumeToken(Token::Kind::TOKEN_IF, "Expected 'if'").getLine();
+	BranchHint hint = BranchHint::None;
+	auto condition = parseCondition("if", hint);
+
+	// A #[cold] block makes the branch leading to it unlikely.
+	const bool thenCold = parseColdMarker();
 	auto thenBranch = parseBlock();
 
 	std::unique_ptr<Node> elseBranch = nullptr;
+	bool elseCold = false;
 	if (matchSingleToken(Token::Kind::TOKEN_ELSE))
 	{
 		consumeToken();
@@ -358,16 +779,124 @@ std::unique_ptr<Node> Parser::parseIfStatement()
 		}
 		else
 		{
+			elseCold = parseColdMarker();
 			elseBranch = parseBlock();
 		}
 	}
 
-	return std::make_unique<NodeIf>(std::move(condition), std::move(thenBranch), std::move(elseBranch), previous().getLine());
+	if (thenCold && elseCold)
+		ERROR(line, "Only one branch of an 'if' can be marked #[cold]");
+	if ((thenCold && hint == BranchHint::Likely) || (elseCold && hint == BranchHint::Unlikely))
+		ERROR(line, "Branch hint contradicts the #[cold] block");
+	if (thenCold)
+		hint = BranchHint::Unlikely;
+	else if (elseCold)
+		hint = BranchHint::Likely;
+
+	auto ifNode = std::make_unique<NodeIf>(std::move(condition), std::move(thenBranch), std::move(elseBranch), line);
+	ifNode->setHint(hint);
+	return ifNode;
+}
+
+std::unique_ptr<Node> Parser::parseMatchStatement()
+{
+	const int line = consumeToken(Token::Kind::TOKEN_MATCH, "Expected 'match'").getLine();
+	auto subject = parseExpression();
+	consumeToken(Token::Kind::TOKEN_LBRACE, "Expected '{' after match subject");
+
+	std::vector<MatchArm> arms;
+	while (!matchSingleToken(Token::Kind::TOKEN_RBRACE))
+	{
+		MatchArm arm{{}, false, nullptr, peek().getLine()};
+		if (matchSingleToken(Token::Kind::TOKEN_IDENTIFIER) && peek().getValue() == "_")
+		{
+			consumeToken();
+			arm.isDefault = true;
+		}
+		else
+		{
+			arm.patterns.push_back(parseMatchPattern());
+			while (matchSingleToken(Token::Kind::TOKEN_PIPE))
+			{
+				consumeToken();
+				arm.patterns.push_back(parseMatchPattern());
+			}
+		}
+
+		consumeToken(Token::Kind::TOKEN_FAT_ARROW, "Expected '=>' after match pattern");
+		arm.body = matchSingleToken(Token::Kind::TOKEN_LBRACE) ? parseBlock() : parseStatement();
+		arms.push_back(std::move(arm));
+
+		if (matchSingleToken(Token::Kind::TOKEN_COMMA))
+			consumeToken();
+	}
+
+	consumeToken(Token::Kind::TOKEN_RBRACE, "Expected '}' after match arms");
+	return std::make_unique<NodeMatch>(std::move(subject), std::move(arms), line);
+}
+
+MatchPattern Parser::parseMatchPattern()
+{
+	const int line = peek().getLine();
+	const int64_t low = parsePatternValue();
+
+	if (matchSingleToken(Token::Kind::TOKEN_DOT_DOT) || matchSingleToken(Token::Kind::TOKEN_DOT_DOT_EQUAL))
+	{
+		const bool inclusive = consumeToken().getKind() == Token::Kind::TOKEN_DOT_DOT_EQUAL;
+		const int64_t end = parsePatternValue();
+		if (!inclusive && end == INT64_MIN)
+			ERROR(line, "Empty range in match pattern");
+		const int64_t high = inclusive ? end : end - 1;
+		if (high < low)
+			ERROR(line, "Empty range in match pattern");
+		return {low, high};
+	}
+
+	return {low, low};
+}
+
+int64_t Parser::parsePatternValue()
+{
+	bool negative = false;
+	if (matchSingleToken(Token::Kind::TOKEN_MINUS))
+	{
+		consumeToken();
+		negative = true;
+	}
+
+	const Token numToken = consumeToken(Token::Kind::TOKEN_NUMBER, "Match patterns must be integer literals");
+	const int64_t value = parseIntegerText(numToken.getValue(), numToken.getLine());
+	// Negating in unsigned arithmetic keeps a hex pattern such as -0x8000000000000000 defined.
+	return negative ? static_cast<int64_t>(0 - static_cast<uint64_t>(value)) : value;
+}
+
+std::unique_ptr<Node> Parser::parseCondition(const std::string &keyword, BranchHint &hint)
+{
+	if (matchSingleToken(Token::Kind::TOKEN_IDENTIFIER) && (peek().getValue() == "likely" || peek().getValue() == "unlikely"))
+		hint = consumeToken().getValue() == "likely" ? BranchHint::Likely : BranchHint::Unlikely;
+
+	consumeToken(Token::Kind::TOKEN_LPAREN, "Expected '(' after '" + keyword + "'");
+	auto condition = parseExpression();
+	consumeToken(Token::Kind::TOKEN_RPAREN, "Expected ')' after condition");
+	return condition;
+}
+
+bool Parser::parseColdMarker()
+{
+	if (!matchSingleToken(Token::Kind::TOKEN_HASH))
+		return false;
+
+	for (const auto &attr : parseAttributes())
+	{
+		if (attr.getName() != "cold" || !attr.getArgs().empty())
+			ERROR(attr.getLine(), "Only #[cold] can be applied to a branch block");
+	}
+	return true;
 }
 
 std::unique_ptr<Node> Parser::parseExternDeclaration()
 {
-	consumeToken(Token::Kind::TOKEN_EXTERN, "Unexpected extern");
+	const int line = consumeToken(Token::Kind::TOKEN_EXTERN, "Unexpected extern").getLine();
 	const std::string name = consumeToken(Token::Kind::TOKEN_IDENTIFIER, "Expected function name").getValue();
 
 	const auto args = parseArgumentList();
@@ -375,12 +904,12 @@ std::unique_ptr<Node> Parser::parseExternDeclaration()
 
 	const std::string returnType = parseType();
 	consumeToken(Token::Kind::TOKEN_SEMI, "Expected ';'");
-	return std::make_unique<NodeExternDeclaration>(name, args, returnType, previous().getLine());
+	return std::make_unique<NodeExternDeclaration>(name, args, returnType, line);
 }
 
 std::unique_ptr<Node> Parser::parseAssignment()
 {
-	auto expr = parseComparison();
+	auto expr = parseLogicalOr();
 
 	if (matchSingleToken(Token::Kind::TOKEN_EQUAL))
 	{
@@ -0,0 +1,49 @@
+#include "../include/codegen.hpp"
+#include "llvm/Transforms/Utils/ModuleUtils.h"
+
+// --instrument-functions=xray. Every defined function is marked xray-always, so the
+// backend gives it an entry sled, an exit sled before each return and a tail sled
+// before each tail call, and lists them in the xray_instr_map section. The sleds are
+// NOPs until libtvysrt patches them (runtime/profile.c); a constructor calling
+// tvys_prof_init lets TVYS_PROFILE switch them on at startup.
+//
+// The runtime only finds addresses in xray_instr_map, so the names come from a
+// table of {ptr function, ptr name} in tvys_prof_map. It is built after the
+// optimizer has run, so it neither keeps functions alive nor lists those that were
+// inlined everywhere and deleted.
+
+void CodeGenerator::instrumentFunctions()
+{
+    for (llvm::Function &function : *module)
+    {
+        if (!function.isDeclaration())
+            function.addFnAttr("function-instrument", "xray-always");
+    }
+
+    llvm::FunctionCallee init = module->getOrInsertFunction("tvys_prof_init", builder.getVoidTy());
+    llvm::appendToGlobalCtors(*module, llvm::cast<llvm::Function>(init.getCallee()), 0);
+}
+
+void CodeGenerator::emitProfileMap()
+{
+    llvm::StructType *entryType = llvm::StructType::get(context, {builder.getPtrTy(), builder.getPtrTy()});
+    std::vector<llvm::Constant *> entries;
+    for (llvm::Function &function : *module)
+    {
+        if (function.isDeclaration() || function.getFnAttribute("function-instrument").getValueAsString() != "xray-always")
+            continue;
+        llvm::Constant *name = llvm::ConstantDataArray::getString(context, function.getName());
+        auto *nameGlobal = new llvm::GlobalVariable(*module, name->getType(), true, llvm::GlobalValue::PrivateLinkage, name, "prof.name");
+        nameGlobal->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+        entries.push_back(llvm::ConstantStruct::get(entryType, {&function, nameGlobal}));
+    }
+    if (entries.empty())
+        return;
+
+    llvm::ArrayType *mapType = llvm::ArrayType::get(entryType, entries.size());
+    auto *map = new llvm::GlobalVariable(*module, mapType, true, llvm::GlobalValue::PrivateLinkage,
+                                         llvm::ConstantArray::get(mapType, entries), "prof.map");
+    map->setSection("tvys_prof_map");
+    map->setAlignment(llvm::Align(8));
+    llvm::appendToUsed(*module, {map});
+}
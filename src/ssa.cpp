@@ -0,0 +1,159 @@
+#include "../include/codegen.hpp"
+#include "../include/walk.hpp"
+#include "llvm/IR/CFG.h"
+
+// Scalar locals that never have their address taken are kept as SSA values
+// instead of allocas, following Braun et al., "Simple and Efficient Construction
+// of Static Single Assignment Form". Each variable records its current value per
+// basic block; reads in other blocks walk the predecessors and insert phis only
+// where control flow merges. Loop headers stay unsealed until their back edge is
+// emitted, and phis created there are completed when the block is sealed.
+
+void CodeGenerator::collectAddressTaken(const Node *body)
+{
+    addressTaken.clear();
+    walkTree(body, [&](const Node *node)
+             {
+        auto unary = dynamic_cast<const NodeUnaryOp *>(node);
+        if (unary && unary->getOp() == Token::Kind::TOKEN_AMPERSAND)
+        {
+            if (auto id = dynamic_cast<const NodeIdentifier *>(unary->getOperand()))
+                addressTaken.insert(id->getName());
+        }
+
+        // A parallel for body runs in another function, so the variables it writes
+        // must live in memory it can reach through the loop's context.
+        auto loop = dynamic_cast<const NodeFor *>(node);
+        if (loop && loop->isParallel())
+        {
+            for (const auto &name : collectParallelWrites(loop))
+                addressTaken.insert(name);
+        } });
+}
+
+bool CodeGenerator::canPromote(const std::string &name, llvm::Type *type) const
+{
+    return currentFunction && !addressTaken.count(name) &&
+           (type->isIntegerTy() || type->isFloatingPointTy() || type->isPointerTy());
+}
+
+int CodeGenerator::declareSSAVariable(const std::string &name, llvm::Type *type)
+{
+    ssaVariables.push_back({name, type, {}});
+    return static_cast<int>(ssaVariables.size() - 1);
+}
+
+void CodeGenerator::writeVariable(int slot, llvm::BasicBlock *block, llvm::Value *value)
+{
+    ssaVariables[slot].defs[block] = value;
+}
+
+llvm::Value *CodeGenerator::readVariable(int slot, llvm::BasicBlock *block)
+{
+    auto &defs = ssaVariables[slot].defs;
+    auto it = defs.find(block);
+    if (it != defs.end() && it->second)
+        return it->second;
+    return readVariableRecursive(slot, block);
+}
+
+llvm::Value *CodeGenerator::readVariableRecursive(int slot, llvm::BasicBlock *block)
+{
+    const SSAVariable &var = ssaVariables[slot];
+    llvm::Value *value = nullptr;
+
+    if (unsealedBlocks.count(block))
+    {
+        llvm::PHINode *phi = createPhi(var, block);
+        incompletePhis[block].push_back({slot, phi});
+        value = phi;
+    }
+    else if (llvm::BasicBlock *pred = block->getSinglePredecessor())
+        value = readVariable(slot, pred);
+    else if (llvm::pred_empty(block))
+        value = llvm::PoisonValue::get(var.type);
+    else
+    {
+        // Record the phi before visiting predecessors so that cycles terminate on it.
+        llvm::PHINode *phi = createPhi(var, block);
+        writeVariable(slot, block, phi);
+        value = addPhiOperands(slot, phi);
+    }
+
+    writeVariable(slot, block, value);
+    return value;
+}
+
+llvm::PHINode *CodeGenerator::createPhi(const SSAVariable &var, llvm::BasicBlock *block)
+{
+    llvm::IRBuilder<> phiBuilder(block, block->begin());
+    llvm::PHINode *phi = phiBuilder.CreatePHI(var.type, 0, var.name);
+    if (var.debugVariable)
+        debugPhis.push_back({phi, var.debugVariable});
+    return phi;
+}
+
+llvm::Value *CodeGenerator::addPhiOperands(int slot, llvm::PHINode *phi)
+{
+    // A phi whose operands are still being collected may look trivial; it is
+    // checked once complete instead of from its operands' removal.
+    pendingPhis.insert(phi);
+    for (llvm::BasicBlock *pred : llvm::predecessors(phi->getParent()))
+        phi->addIncoming(readVariable(slot, pred), pred);
+    pendingPhis.erase(phi);
+    return tryRemoveTrivialPhi(phi);
+}
+
+llvm::Value *CodeGenerator::tryRemoveTrivialPhi(llvm::PHINode *phi)
+{
+    llvm::Value *same = nullptr;
+    for (llvm::Value *operand : phi->incoming_values())
+    {
+        if (operand == same || operand == phi)
+            continue;
+        if (same)
+            return phi;
+        same = operand;
+    }
+    if (!same)
+        same = llvm::PoisonValue::get(phi->getType());
+
+    std::vector<llvm::WeakTrackingVH> phiUsers;
+    for (llvm::User *user : phi->users())
+    {
+        if (user != phi && llvm::isa<llvm::PHINode>(user) && !pendingPhis.count(llvm::cast<llvm::PHINode>(user)))
+            phiUsers.emplace_back(user);
+    }
+
+    // The per-block definitions are tracking handles, so they follow the replacement too.
+    phi->replaceAllUsesWith(same);
+    phi->eraseFromParent();
+
+    for (auto &user : phiUsers)
+    {
+        if (auto *userPhi = llvm::dyn_cast_or_null<llvm::PHINode>(user))
+            tryRemoveTrivialPhi(userPhi);
+    }
+    return same;
+}
+
+void CodeGenerator::sealBlock(llvm::BasicBlock *block)
+{
+    auto it = incompletePhis.find(block);
+    unsealedBlocks.erase(block);
+    if (it == incompletePhis.end())
+        return;
+
+    auto phis = std::move(it->second);
+    incompletePhis.erase(it);
+    for (auto &[slot, phi] : phis)
+        addPhiOperands(slot, phi);
+}
+
+void CodeGenerator::resetSSAState()
+{
+    ssaVariables.clear();
+    unsealedBlocks.clear();
+    incompletePhis.clear();
+    pendingPhis.clear();
+}
@@ -0,0 +1,94 @@
+#include "../include/walk.hpp"
+#include "../include/parser.hpp"
+
+void forEachChild(const Node *node, const std::function<void(const Node *)> &visit)
+{
+    auto visitIf = [&](const Node *child)
+    {
+        if (child)
+            visit(child);
+    };
+
+    if (auto block = dynamic_cast<const NodeBlock *>(node))
+    {
+        for (const auto &stmt : block->getStatements())
+            visitIf(stmt.get());
+    }
+    else if (auto binary = dynamic_cast<const NodeBinaryOp *>(node))
+    {
+        visitIf(binary->getLeft());
+        visitIf(binary->getRight());
+    }
+    else if (auto unary = dynamic_cast<const NodeUnaryOp *>(node))
+        visitIf(unary->getOperand());
+    else if (auto await = dynamic_cast<const NodeAwait *>(node))
+        visitIf(await->getOperand());
+    else if (auto cast = dynamic_cast<const NodeCast *>(node))
+        visitIf(cast->getExpression());
+    else if (auto assign = dynamic_cast<const NodeAssignment *>(node))
+        visitIf(assign->getValue());
+    else if (auto ptrAssign = dynamic_cast<const NodePointerAssignment *>(node))
+    {
+        visitIf(ptrAssign->getPointer());
+        visitIf(ptrAssign->getValue());
+    }
+    else if (auto arrayAccess = dynamic_cast<const NodeArrayAccess *>(node))
+        visitIf(arrayAccess->getIndex());
+    else if (auto arrayAssign = dynamic_cast<const NodeArrayAssignment *>(node))
+    {
+        visitIf(arrayAssign->getIndex());
+        visitIf(arrayAssign->getValue());
+    }
+    else if (auto literal = dynamic_cast<const NodeArrayLiteral *>(node))
+    {
+        for (const auto &element : literal->getElements())
+            visitIf(element.get());
+    }
+    else if (auto call = dynamic_cast<const NodeFunctionCall *>(node))
+    {
+        for (const auto &arg : call->getArgs())
+            visitIf(arg.get());
+    }
+    else if (auto builtin = dynamic_cast<const NodeBuiltinCall *>(node))
+    {
+        for (const auto &arg : builtin->getArgs())
+            visitIf(arg.get());
+    }
+    else if (auto varDecl = dynamic_cast<const NodeVariableDeclaration *>(node))
+        visitIf(varDecl->getInitializer());
+    else if (auto funcDecl = dynamic_cast<const NodeFunctionDeclaration *>(node))
+        visitIf(funcDecl->getBody().get());
+    else if (auto returnStmt = dynamic_cast<const NodeReturn *>(node))
+        visitIf(returnStmt->getExpression());
+    else if (auto whileStmt = dynamic_cast<const NodeWhile *>(node))
+    {
+        visitIf(whileStmt->getCondition());
+        visitIf(whileStmt->getBody());
+    }
+    else if (auto forStmt = dynamic_cast<const NodeFor *>(node))
+    {
+        visitIf(forStmt->getStart());
+        visitIf(forStmt->getEnd());
+        visitIf(forStmt->getStep());
+        visitIf(forStmt->getBody());
+    }
+    else if (auto ifStmt = dynamic_cast<const NodeIf *>(node))
+    {
+        visitIf(ifStmt->getCondition());
+        visitIf(ifStmt->getThenBranch());
+        visitIf(ifStmt->getElseBranch());
+    }
+    else if (auto matchStmt = dynamic_cast<const NodeMatch *>(node))
+    {
+        visitIf(matchStmt->getSubject());
+        for (const auto &arm : matchStmt->getArms())
+            visitIf(arm.body.get());
+    }
+}
+
+void walkTree(const Node *node, const std::function<void(const Node *)> &visit)
+{
+    visit(node);
+    forEachChild(node, [&](const Node *child)
+                 { walkTree(child, visit); });
+}
\ No newline at end of file